@@ -0,0 +1,341 @@
+#include "ofMain.h"
+#include "ofxIldaFile.h"
+#include <new>
+#include <sys/resource.h>
+
+//headless benchmark of ilda_file load / write, round trip and points_buffer conversion on synthetic corpora.
+//no window and no gl context are created, so it runs on a plain linux box.
+//usage : example_benchmark [--quick] [--reps n] [--dir path] [--csv]
+//exit code 1 when a round trip does not reproduce the generated file byte for byte.
+
+namespace{
+    std::atomic<uint64_t> alloc_count{0};
+    std::atomic<uint64_t> alloc_bytes{0};
+    
+    //every replaced operator goes through these two. kept out of line, so gcc never sees free() inlined
+    //into a delete paired with operator new and -Wmismatched-new-delete stays quiet.
+#ifdef __GNUC__
+    __attribute__((noinline))
+#endif
+    void* counted_alloc(std::size_t size) noexcept{
+        ++alloc_count;
+        alloc_bytes += size;
+        return std::malloc(size ? size : 1);
+    }
+    
+#ifdef __GNUC__
+    __attribute__((noinline))
+#endif
+    void counted_free(void* p) noexcept{ std::free(p); }
+}
+
+void* operator new(std::size_t size){
+    if(void* p = counted_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size){
+    if(void* p = counted_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept{ return counted_alloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept{ return counted_alloc(size); }
+void operator delete(void* p) noexcept{ counted_free(p); }
+void operator delete[](void* p) noexcept{ counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept{ counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept{ counted_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept{ counted_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept{ counted_free(p); }
+
+namespace bench{
+    using namespace ofx::IldaFile;
+
+    //xorshift64*, the same seed always gives the same corpus
+    struct random_source{
+        random_source(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1){}
+        uint64_t next(){
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+        float uniform(){ return (next() >> 40) / float(1 << 24); }
+        uint64_t state;
+    };
+
+    struct corpus_spec{
+        FORMAT format;
+        std::size_t frames;
+        std::size_t points;
+        float blank_density;
+        uint64_t seed;
+    };
+
+    const std::size_t record_size(FORMAT format){
+        return load_functions::commons::record_size(format);
+    }
+
+    void put_16b(std::vector<uint8_t>& out, uint16_t value){
+        out.push_back(value >> 8);
+        out.push_back(value & 0xFF);
+    }
+
+    void put_header(std::vector<uint8_t>& out, uint8_t format, uint16_t records, uint16_t frame_number, uint16_t total_frames){
+        const char head[] = {'I', 'L', 'D', 'A', 0, 0, 0};
+        out.insert(out.end(), head, head + 7);
+        out.push_back(format);
+        const char name[16] = {'b', 'e', 'n', 'c', 'h', 0, 0, 0, 'o', 'f', 'x', 'I', 'l', 'd', 'a', 0};
+        out.insert(out.end(), name, name + 16);
+        put_16b(out, records);
+        put_16b(out, frame_number);
+        put_16b(out, total_frames);
+        out.push_back(0);
+        out.push_back(0);
+    }
+
+    //encodes the corpus by hand, independent of the writer under test. indexed corpora start with a 64 color palette.
+    //points walk a random path, a blanked point starts a new stroke.
+    std::vector<uint8_t> generate(const corpus_spec& spec){
+        random_source rng(spec.seed);
+        std::vector<uint8_t> out;
+        out.reserve((spec.frames + 2) * (32 + spec.points * record_size(spec.format)));
+        const bool indexed = spec.format == FORMAT::Coordinates3D || spec.format == FORMAT::Coordinates2D;
+        if(indexed){
+            put_header(out, FORMAT::ColorPalette, 64, 0, 1);
+            for(std::size_t i = 0 ; i < 64 * 3 ; ++i) out.push_back(rng.next());
+        }
+        const bool is_3d = spec.format == FORMAT::Coordinates3D || spec.format == FORMAT::Coordinates3DwTrueColor;
+        for(std::size_t f = 0 ; f < spec.frames ; ++f){
+            put_header(out, spec.format, spec.points, f, spec.frames);
+            int x = 0, y = 0, z = 0;
+            for(std::size_t i = 0 ; i < spec.points ; ++i){
+                x = ofClamp(x + int(rng.next() % 2049) - 1024, -32768, 32767);
+                y = ofClamp(y + int(rng.next() % 2049) - 1024, -32768, 32767);
+                z = ofClamp(z + int(rng.next() % 257) - 128, -32768, 32767);
+                put_16b(out, x);
+                put_16b(out, y);
+                if(is_3d) put_16b(out, z);
+                uint8_t status = rng.uniform() < spec.blank_density ? 1 << 6 : 0;
+                if(i + 1 == spec.points) status |= 1 << 7;
+                out.push_back(status);
+                const uint64_t color = rng.next();
+                if(indexed){
+                    out.push_back(color % 64);
+                }else{
+                    out.push_back(color);
+                    out.push_back(color >> 8);
+                    out.push_back(color >> 16);
+                }
+            }
+        }
+        put_header(out, spec.format, 0, spec.frames, spec.frames);
+        return out;
+    }
+
+    std::vector<ofxIlda::Point> generate_points(random_source& rng, std::size_t points){
+        std::vector<ofxIlda::Point> frame(points);
+        for(auto& p : frame){
+            p = ofxIlda::Point(rng.next(), rng.next(), rng.next(), rng.next(), rng.next(), kIldaMaxIntensity);
+        }
+        return frame;
+    }
+
+    const bool write_bytes(const std::string& path, const std::vector<uint8_t>& bytes){
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write((const char*)bytes.data(), bytes.size());
+        return ofs.good();
+    }
+
+    std::vector<uint8_t> read_bytes(const std::string& path){
+        std::ifstream ifs(path, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    }
+
+    //VmRSS and VmHWM (peak) of the process in KiB, 0 when /proc is not available
+    void memory_kib(uint64_t& rss, uint64_t& peak){
+        rss = peak = 0;
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while(std::getline(status, line)){
+            if(line.compare(0, 6, "VmRSS:") == 0) rss = std::strtoull(line.c_str() + 6, nullptr, 10);
+            if(line.compare(0, 6, "VmHWM:") == 0) peak = std::strtoull(line.c_str() + 6, nullptr, 10);
+        }
+        if(peak == 0){
+            struct rusage usage;
+            if(getrusage(RUSAGE_SELF, &usage) == 0) peak = usage.ru_maxrss;
+        }
+    }
+
+    //resets the peak so each case reports its own high water mark (linux 4.0+, silently ignored elsewhere)
+    void reset_peak(){
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        if(clear_refs) clear_refs << "5";
+    }
+
+    struct result{
+        double seconds = 0;
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+        uint64_t rss = 0;
+        uint64_t peak = 0;
+    };
+
+    //best wall time of reps runs. allocations and memory are taken from the last run.
+    template<typename function_type>
+    result measure(std::size_t reps, function_type&& run){
+        result best;
+        best.seconds = std::numeric_limits<double>::max();
+        for(std::size_t r = 0 ; r < reps ; ++r){
+            reset_peak();
+            const uint64_t count = alloc_count;
+            const uint64_t bytes = alloc_bytes;
+            const auto begin = std::chrono::steady_clock::now();
+            run();
+            const auto end = std::chrono::steady_clock::now();
+            best.seconds = std::min(best.seconds, std::chrono::duration<double>(end - begin).count());
+            best.allocations = alloc_count - count;
+            best.allocated_bytes = alloc_bytes - bytes;
+            memory_kib(best.rss, best.peak);
+        }
+        return best;
+    }
+
+    const char* format_name(FORMAT format){
+        switch (format){
+            case FORMAT::Coordinates3D : return "3d_indexed";
+            case FORMAT::Coordinates2D : return "2d_indexed";
+            case FORMAT::ColorPalette : return "palette";
+            case FORMAT::Coordinates3DwTrueColor : return "3d_true";
+            case FORMAT::Coordinates2DwTrueColor : return "2d_true";
+            default: return "unknown";
+        }
+    }
+
+    struct report{
+        bool csv = false;
+
+        void header(){
+            if(csv){
+                std::printf("case,format,frames,points,blank,bytes,seconds,mb_per_s,frames_per_s,allocations,alloc_mb,rss_kib,peak_kib\n");
+            }else{
+                std::printf("%-16s %-10s %6s %6s %5s %10s %10s %12s %10s %9s %9s %9s\n",
+                            "case", "format", "frames", "points", "blank", "MB/s", "frames/s", "allocations", "alloc MB", "ms", "rss KiB", "peak KiB");
+            }
+        }
+
+        void row(const std::string& name, const corpus_spec& spec, std::size_t bytes, const result& r){
+            const double mb = bytes / (1024.0 * 1024.0);
+            const double mb_per_s = r.seconds > 0 ? mb / r.seconds : 0;
+            const double frames_per_s = r.seconds > 0 ? spec.frames / r.seconds : 0;
+            if(csv){
+                std::printf("%s,%s,%zu,%zu,%.2f,%zu,%.6f,%.2f,%.1f,%llu,%.2f,%llu,%llu\n",
+                            name.c_str(), format_name(spec.format), spec.frames, spec.points, spec.blank_density, bytes,
+                            r.seconds, mb_per_s, frames_per_s, (unsigned long long)r.allocations, r.allocated_bytes / (1024.0 * 1024.0),
+                            (unsigned long long)r.rss, (unsigned long long)r.peak);
+            }else{
+                std::printf("%-16s %-10s %6zu %6zu %5.2f %10.1f %10.1f %12llu %10.1f %9.2f %9llu %9llu\n",
+                            name.c_str(), format_name(spec.format), spec.frames, spec.points, spec.blank_density,
+                            mb_per_s, frames_per_s, (unsigned long long)r.allocations, r.allocated_bytes / (1024.0 * 1024.0), r.seconds * 1000.0,
+                            (unsigned long long)r.rss, (unsigned long long)r.peak);
+            }
+            std::fflush(stdout);
+        }
+    };
+}
+
+int main(int argc, char** argv){
+    using namespace bench;
+    bool quick = false;
+    std::size_t reps = 3;
+    std::string dir = ".";
+    report out;
+    for(int i = 1 ; i < argc ; ++i){
+        const std::string arg = argv[i];
+        if(arg == "--quick") quick = true;
+        else if(arg == "--csv") out.csv = true;
+        else if(arg == "--reps" && i + 1 < argc) reps = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--dir" && i + 1 < argc) dir = argv[++i];
+    }
+    ofSetLogLevel(OF_LOG_WARNING);
+
+    const std::string source_path = dir + "/ofxIldaFile_bench_source.ild";
+    const std::string output_path = dir + "/ofxIldaFile_bench_output.ild";
+    const FORMAT formats[] = {FORMAT::Coordinates3D, FORMAT::Coordinates2D, FORMAT::Coordinates3DwTrueColor, FORMAT::Coordinates2DwTrueColor};
+    const std::vector<std::size_t> frame_counts = quick ? std::vector<std::size_t>{50} : std::vector<std::size_t>{200, 2000};
+    const std::vector<std::size_t> point_counts = quick ? std::vector<std::size_t>{300} : std::vector<std::size_t>{100, 2000};
+    const std::vector<float> blank_densities = quick ? std::vector<float>{0.1f} : std::vector<float>{0.0f, 0.3f};
+    bool failed = false;
+
+    out.header();
+    uint64_t seed = 1;
+    for(FORMAT format : formats){
+        for(std::size_t frames : frame_counts){
+            for(std::size_t points : point_counts){
+                for(float blank : blank_densities){
+                    const corpus_spec spec{format, frames, points, blank, seed++};
+                    const std::vector<uint8_t> source = generate(spec);
+                    if(!write_bytes(source_path, source)){
+                        std::fprintf(stderr, "cannot write %s\n", source_path.c_str());
+                        return 1;
+                    }
+                    const std::size_t bytes = source.size();
+
+                    out.row("load_stream", spec, bytes, measure(reps, [&](){
+                        ilda_file file;
+                        file.load(source_path, LOAD_MODE::Stream);
+                    }));
+                    out.row("load_mapped", spec, bytes, measure(reps, [&](){
+                        ilda_file file;
+                        file.load(source_path, LOAD_MODE::MemoryMapped);
+                    }));
+                    out.row("load_parallel", spec, bytes, measure(reps, [&](){
+                        ilda_file file;
+                        file.load_parallel(source_path);
+                    }));
+
+                    ilda_file loaded;
+                    loaded.load(source_path);
+                    out.row("write_buffered", spec, bytes, measure(reps, [&](){
+                        loaded.write(output_path, WRITE_MODE::Buffered);
+                    }));
+                    out.row("write_mapped", spec, bytes, measure(reps, [&](){
+                        loaded.write(output_path, WRITE_MODE::MappedOutput);
+                    }));
+
+                    out.row("round_trip", spec, bytes, measure(reps, [&](){
+                        ilda_file file;
+                        file.load(source_path);
+                        file.write(output_path);
+                    }));
+                    if(read_bytes(output_path) != source){
+                        std::fprintf(stderr, "round trip mismatch %s %zu x %zu\n", format_name(format), frames, points);
+                        failed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    //points_buffer conversion, always format 5
+    for(std::size_t frames : frame_counts){
+        for(std::size_t points : point_counts){
+            const corpus_spec spec{FORMAT::Coordinates2DwTrueColor, frames, points, 0, seed++};
+            random_source rng(spec.seed);
+            points_buffer buffer;
+            for(std::size_t f = 0 ; f < frames ; ++f) buffer.set_frame(f, generate_points(rng, points));
+            //to_file writes frames 0 .. frames - 2 and the end of file section
+            const std::size_t bytes = frames * 32 + (frames - 1) * points * 8;
+            out.row("to_file_write", spec, bytes, measure(reps, [&](){
+                ilda_file file;
+                buffer.to_file(file);
+                file.write(output_path);
+            }));
+            out.row("write_file", spec, bytes, measure(reps, [&](){
+                buffer.write_file(output_path);
+            }));
+        }
+    }
+
+    std::remove(source_path.c_str());
+    std::remove(output_path.c_str());
+    return failed ? 1 : 0;
+}
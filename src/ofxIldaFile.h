@@ -1,5 +1,39 @@
 #pragma once
 #include "ofMain.h"
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <list>
+#include <unordered_map>
+
+#if !defined(OFX_ILDA_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define OFX_ILDA_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define OFX_ILDA_TARGET_SSSE3
+#define OFX_ILDA_TARGET_AVX2
+#else
+#define OFX_ILDA_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define OFX_ILDA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//load / write instrumentation, see ilda_stats. OFX_ILDA_NO_STATS compiles it out.
+#ifndef OFX_ILDA_NO_STATS
+#define OFX_ILDA_STAT(statement) statement
+#else
+#define OFX_ILDA_STAT(statement)
+#endif
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 //ref : ILDA Image Data Transfer Format Specification revision 011
 
@@ -17,427 +51,3832 @@ namespace ofx{
                 return value;
             }
             
-            template<typename T>
-            T reverse_32b(T value){
-                value = static_cast<T> (( value & 0x00FF00FF ) << 8 | ( value & 0xFF00FF00 ) >> 8 );
-                value = static_cast<T> (( value & 0x0000FFFF ) << 16 | ( value & 0xFFFF0000 ) >> 16 );
-                return value;
+            template<typename T>
+            T reverse_32b(T value){
+                value = static_cast<T> (( value & 0x00FF00FF ) << 8 | ( value & 0xFF00FF00 ) >> 8 );
+                value = static_cast<T> (( value & 0x0000FFFF ) << 16 | ( value & 0xFFFF0000 ) >> 16 );
+                return value;
+            }
+            
+            template<typename T>
+            T read_16b(const uint8_t* src){
+                T value;
+                std::memcpy(&value, src, 2);
+                return reverse_16b(value);
+            }
+            
+            template<typename T>
+            void write_16b(uint8_t* dst, T value){
+                value = reverse_16b(value);
+                std::memcpy(dst, &value, 2);
+            }
+            
+            void set_point(ofVec2f& point, float x, float y, float z){ point.set(x, y); }
+            void set_point(ofVec3f& point, float x, float y, float z){ point.set(x, y, z); }
+            
+            //0x00RRGGBB or palette index <-> tuple color element
+            void set_color(ofColor& color, uint32_t value){ color.set((value >> 16) & 0xFF, (value >> 8) & 0xFF, value & 0xFF); }
+            void set_color(uint8_t& index, uint32_t value){ index = value; }
+            uint32_t get_color(const ofColor& color){ return uint32_t(color.r) << 16 | uint32_t(color.g) << 8 | uint32_t(color.b); }
+            uint32_t get_color(uint8_t index){ return index; }
+            
+            //64 bit hash of a byte range, 8 bytes per step
+            uint64_t hash_bytes(const uint8_t* src, std::size_t size){
+                const uint64_t k = 0x9E3779B97F4A7C15ULL;
+                uint64_t h = size * k;
+                std::size_t i = 0;
+                for(; i + 8 <= size ; i += 8){
+                    uint64_t v;
+                    std::memcpy(&v, src + i, 8);
+                    h = (h ^ v) * k;
+                    h ^= h >> 29;
+                }
+                uint64_t tail = 0;
+                std::memcpy(&tail, src + i, size - i);
+                h = (h ^ tail) * k;
+                return h ^ (h >> 32);
+            }
+            
+            //size and modification time of a file, used to tell whether a cache derived from it is still current
+            const bool file_stamp(const std::string& path, uint64_t& size, int64_t& mtime){
+#ifdef TARGET_WIN32
+                WIN32_FILE_ATTRIBUTE_DATA data;
+                if(!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) return false;
+                size = uint64_t(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+                mtime = int64_t(uint64_t(data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime);
+#else
+                struct stat st;
+                if(::stat(path.c_str(), &st) != 0) return false;
+                size = st.st_size;
+#ifdef __APPLE__
+                mtime = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+                mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+                return true;
+            }
+            
+            //cuts or extends a file to size bytes
+            const bool truncate_file(const std::string& path, uint64_t size){
+#ifdef TARGET_WIN32
+                HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+                if(handle == INVALID_HANDLE_VALUE) return false;
+                LARGE_INTEGER position;
+                position.QuadPart = size;
+                const bool done = SetFilePointerEx(handle, position, NULL, FILE_BEGIN) && SetEndOfFile(handle);
+                CloseHandle(handle);
+                return done;
+#else
+                return ::truncate(path.c_str(), size) == 0;
+#endif
+            }
+            
+            //read only mapping of a whole file. pages are faulted in on first touch, so only the parts actually decoded are read from disk.
+            struct mapped_file{
+                mapped_file(){}
+                mapped_file(const mapped_file&) = delete;
+                mapped_file& operator=(const mapped_file&) = delete;
+                ~mapped_file(){ close(); }
+                
+                const bool open(const std::string& path){
+                    close();
+#ifdef TARGET_WIN32
+                    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+                    if(file_handle == INVALID_HANDLE_VALUE) return false;
+                    LARGE_INTEGER file_size;
+                    if(!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0){
+                        close();
+                        return false;
+                    }
+                    map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+                    if(map_handle == NULL){
+                        close();
+                        return false;
+                    }
+                    void* ptr = MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+                    if(ptr == NULL){
+                        close();
+                        return false;
+                    }
+                    bytes = (uint8_t*)ptr;
+                    length = file_size.QuadPart;
+#else
+                    fd = ::open(path.c_str(), O_RDONLY);
+                    if(fd < 0) return false;
+                    struct stat st;
+                    if(fstat(fd, &st) != 0 || st.st_size == 0){
+                        close();
+                        return false;
+                    }
+                    void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if(ptr == MAP_FAILED){
+                        close();
+                        return false;
+                    }
+                    bytes = (uint8_t*)ptr;
+                    length = st.st_size;
+#endif
+                    return true;
+                }
+                
+                //creates (or truncates) path with size bytes and maps it writable. changes reach the file on close().
+                const bool create(const std::string& path, std::size_t size){
+                    close();
+                    if(size == 0) return false;
+#ifdef TARGET_WIN32
+                    file_handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+                    if(file_handle == INVALID_HANDLE_VALUE) return false;
+                    LARGE_INTEGER file_size;
+                    file_size.QuadPart = size;
+                    map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READWRITE, file_size.HighPart, file_size.LowPart, NULL);
+                    if(map_handle == NULL){
+                        close();
+                        return false;
+                    }
+                    void* ptr = MapViewOfFile(map_handle, FILE_MAP_WRITE, 0, 0, 0);
+                    if(ptr == NULL){
+                        close();
+                        return false;
+                    }
+#else
+                    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+                    if(fd < 0) return false;
+                    if(ftruncate(fd, size) != 0){
+                        close();
+                        return false;
+                    }
+                    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                    if(ptr == MAP_FAILED){
+                        close();
+                        return false;
+                    }
+#endif
+                    bytes = (uint8_t*)ptr;
+                    length = size;
+                    return true;
+                }
+                
+                void close(){
+#ifdef TARGET_WIN32
+                    if(bytes) UnmapViewOfFile(bytes);
+                    if(map_handle != NULL) CloseHandle(map_handle);
+                    if(file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+                    map_handle = NULL;
+                    file_handle = INVALID_HANDLE_VALUE;
+#else
+                    if(bytes) munmap((void*)bytes, length);
+                    if(fd >= 0) ::close(fd);
+                    fd = -1;
+#endif
+                    bytes = nullptr;
+                    length = 0;
+                }
+                
+                const bool is_open() const{ return bytes != nullptr; }
+                const uint8_t* data() const{ return bytes; }
+                uint8_t* data(){ return bytes; }
+                std::size_t size() const{ return length; }
+                
+            private:
+                uint8_t* bytes = nullptr;
+                std::size_t length = 0;
+#ifdef TARGET_WIN32
+                HANDLE file_handle = INVALID_HANDLE_VALUE;
+                HANDLE map_handle = NULL;
+#else
+                int fd = -1;
+#endif
+            };
+            
+            //fixed set of worker threads running index ranges. the calling thread takes part as worker 0,
+            //so a pool of n workers owns n - 1 threads and parallel_for(count, fn) calls fn(index, worker) with worker < size().
+            struct worker_pool{
+                worker_pool(std::size_t num_workers = std::thread::hardware_concurrency()){
+                    num_workers = std::max<std::size_t>(num_workers, 1);
+                    for(std::size_t w = 1 ; w < num_workers ; ++w){
+                        threads.emplace_back([this, w](){ work(w); });
+                    }
+                }
+                worker_pool(const worker_pool&) = delete;
+                worker_pool& operator=(const worker_pool&) = delete;
+                ~worker_pool(){
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        quit = true;
+                    }
+                    wake.notify_all();
+                    for(auto& t : threads) t.join();
+                }
+                
+                std::size_t size() const{ return threads.size() + 1; }
+                
+                void parallel_for(std::size_t count, const std::function<void(std::size_t, std::size_t)>& fn){
+                    if(count == 0) return;
+                    std::lock_guard<std::mutex> run_lock(run_mutex);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        job = &fn;
+                        job_count = count;
+                        next = 0;
+                        active = threads.size();
+                        ++generation;
+                    }
+                    wake.notify_all();
+                    run(0);
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait(lock, [this](){ return active == 0; });
+                    job = nullptr;
+                }
+                
+            private:
+                void run(std::size_t worker){
+                    for(std::size_t i = next++ ; i < job_count ; i = next++) (*job)(i, worker);
+                }
+                
+                void work(std::size_t worker){
+                    uint64_t seen = 0;
+                    while(true){
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            wake.wait(lock, [&](){ return quit || generation != seen; });
+                            if(quit) return;
+                            seen = generation;
+                        }
+                        run(worker);
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(--active == 0) done.notify_all();
+                    }
+                }
+                
+                std::vector<std::thread> threads;
+                std::mutex run_mutex;
+                std::mutex mutex;
+                std::condition_variable wake;
+                std::condition_variable done;
+                const std::function<void(std::size_t, std::size_t)>* job = nullptr;
+                std::size_t job_count = 0;
+                std::atomic<std::size_t> next{0};
+                std::size_t active = 0;
+                uint64_t generation = 0;
+                bool quit = false;
+            };
+            
+            //bounded single producer / single consumer ring buffer. push and pop never lock or wait,
+            //push may be called from one thread and pop from one other thread. capacity is rounded up to a power of two.
+            template<typename T>
+            struct spsc_queue{
+                spsc_queue(std::size_t capacity = 16){
+                    std::size_t size = 2;
+                    while(size < capacity) size <<= 1;
+                    slots.resize(size);
+                    mask = size - 1;
+                }
+                spsc_queue(const spsc_queue&) = delete;
+                spsc_queue& operator=(const spsc_queue&) = delete;
+                
+                //false when full
+                const bool push(const T& value){
+                    const std::size_t t = tail.load(std::memory_order_relaxed);
+                    if(t - head.load(std::memory_order_acquire) == slots.size()) return false;
+                    slots[t & mask] = value;
+                    tail.store(t + 1, std::memory_order_release);
+                    return true;
+                }
+                
+                //false when empty. the slot is cleared so the queue keeps no reference to popped values.
+                const bool pop(T& value){
+                    const std::size_t h = head.load(std::memory_order_relaxed);
+                    if(h == tail.load(std::memory_order_acquire)) return false;
+                    value = std::move(slots[h & mask]);
+                    slots[h & mask] = T();
+                    head.store(h + 1, std::memory_order_release);
+                    return true;
+                }
+                
+                //head first, tail only grows so it is never read behind it and the difference cannot wrap
+                std::size_t size() const{
+                    const std::size_t h = head.load(std::memory_order_acquire);
+                    return tail.load(std::memory_order_acquire) - h;
+                }
+                
+                std::size_t capacity() const{ return slots.size(); }
+                
+            private:
+                std::vector<T> slots;
+                std::size_t mask;
+                //head and tail on their own cache lines
+                char padding_head[64];
+                std::atomic<std::size_t> head{0};
+                char padding_tail[64];
+                std::atomic<std::size_t> tail{0};
+                char padding_end[64];
+            };
+        };
+        
+        enum LOAD_MODE{
+            Stream = 0,
+            MemoryMapped = 1,
+        };
+        
+        enum WRITE_MODE{
+            Buffered = 0,
+            MappedOutput = 1,
+        };
+        
+        enum FORMAT{
+            Coordinates3D = 0,
+            Coordinates2D = 1,
+            ColorPalette = 2,
+            Coordinates3DwTrueColor = 4,
+            Coordinates2DwTrueColor = 5,
+        };
+        
+        //byte offsets of the 32 byte section header, the same for every format.
+        //ColorPalette sections store the palette number where point sections store frame_number.
+        struct header_layout{
+            static constexpr std::size_t size = 32;
+            static constexpr std::size_t magic = 0;
+            static constexpr std::size_t format = 7;
+            static constexpr std::size_t name = 8;
+            static constexpr std::size_t company_name = 16;
+            static constexpr std::size_t name_length = 8;
+            static constexpr std::size_t number_of_records = 24;
+            static constexpr std::size_t frame_number = 26;
+            static constexpr std::size_t total_frames = 28;
+            static constexpr std::size_t projector_number = 30;
+            static constexpr std::size_t none = 31;
+        };
+        
+        //compile time description of each format. z_offset is -1 for 2D formats, indexed formats have true_color false.
+        template<FORMAT format> struct format_traits{};
+        template<> struct format_traits<FORMAT::Coordinates3D>{
+            typedef header_layout header;
+            typedef ofVec3f point_type;
+            typedef uint8_t color_type;
+            static constexpr std::size_t record_size = 8;
+            static constexpr std::size_t dimensions = 3;
+            static constexpr int z_offset = 4;
+            static constexpr std::size_t status_offset = 6;
+            static constexpr bool true_color = false;
+            static constexpr FORMAT true_color_format = FORMAT::Coordinates3DwTrueColor;
+        };
+        template<> struct format_traits<FORMAT::Coordinates2D>{
+            typedef header_layout header;
+            typedef ofVec2f point_type;
+            typedef uint8_t color_type;
+            static constexpr std::size_t record_size = 6;
+            static constexpr std::size_t dimensions = 2;
+            static constexpr int z_offset = -1;
+            static constexpr std::size_t status_offset = 4;
+            static constexpr bool true_color = false;
+            static constexpr FORMAT true_color_format = FORMAT::Coordinates2DwTrueColor;
+        };
+        //no points, records are r g b
+        template<> struct format_traits<FORMAT::ColorPalette>{
+            typedef header_layout header;
+            typedef void point_type;
+            typedef ofColor color_type;
+            static constexpr std::size_t record_size = 3;
+            static constexpr std::size_t dimensions = 0;
+            static constexpr int z_offset = -1;
+            static constexpr std::size_t status_offset = 0;
+            static constexpr bool true_color = true;
+            static constexpr FORMAT true_color_format = FORMAT::ColorPalette;
+        };
+        template<> struct format_traits<FORMAT::Coordinates3DwTrueColor>{
+            typedef header_layout header;
+            typedef ofVec3f point_type;
+            typedef ofColor color_type;
+            static constexpr std::size_t record_size = 10;
+            static constexpr std::size_t dimensions = 3;
+            static constexpr int z_offset = 4;
+            static constexpr std::size_t status_offset = 6;
+            static constexpr bool true_color = true;
+            static constexpr FORMAT true_color_format = FORMAT::Coordinates3DwTrueColor;
+        };
+        template<> struct format_traits<FORMAT::Coordinates2DwTrueColor>{
+            typedef header_layout header;
+            typedef ofVec2f point_type;
+            typedef ofColor color_type;
+            static constexpr std::size_t record_size = 8;
+            static constexpr std::size_t dimensions = 2;
+            static constexpr int z_offset = -1;
+            static constexpr std::size_t status_offset = 4;
+            static constexpr bool true_color = true;
+            static constexpr FORMAT true_color_format = FORMAT::Coordinates2DwTrueColor;
+        };
+        
+        template<FORMAT format> struct format_tag{ static constexpr FORMAT value = format; };
+        
+        //the one runtime switch over FORMAT. calls visitor(format_tag<format>()), unknown formats return a value initialized result.
+        template<typename visitor_type>
+        auto dispatch(FORMAT format, visitor_type&& visitor) -> decltype(visitor(format_tag<FORMAT::Coordinates3D>())){
+            switch (format){
+                case FORMAT::Coordinates3D : return visitor(format_tag<FORMAT::Coordinates3D>());
+                case FORMAT::Coordinates2D : return visitor(format_tag<FORMAT::Coordinates2D>());
+                case FORMAT::ColorPalette : return visitor(format_tag<FORMAT::ColorPalette>());
+                case FORMAT::Coordinates3DwTrueColor : return visitor(format_tag<FORMAT::Coordinates3DwTrueColor>());
+                case FORMAT::Coordinates2DwTrueColor : return visitor(format_tag<FORMAT::Coordinates2DwTrueColor>());
+                default: return decltype(visitor(format_tag<FORMAT::Coordinates3D>()))();
+            }
+        }
+        
+        struct ilda_section_base{
+            FORMAT format;
+            std::string name;
+            std::string company_name;
+            uint16_t number_of_records;
+            uint16_t frame_number;
+            uint16_t total_frames;
+            uint8_t projector_number;
+            uint8_t none;
+        };
+        
+        template<FORMAT format_type>
+        struct ilda_section : ilda_section_base{};
+        
+        //256 entry color lookup table, 0x00RRGGBB per entry
+        struct ilda_palette{
+            std::array<uint32_t, 256> lut;
+            
+            ofColor color(uint8_t index) const{
+                const uint32_t c = lut[index];
+                return ofColor((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+            }
+            
+            //default palette of the specification, 64 colors. the remaining entries are black.
+            static const std::shared_ptr<const ilda_palette>& default_palette(){
+                static const std::shared_ptr<const ilda_palette> palette = [](){
+                    static const uint8_t table[64][3] = {
+                        {255,   0,   0}, {255,  16,   0}, {255,  32,   0}, {255,  48,   0}, {255,  64,   0}, {255,  80,   0}, {255,  96,   0}, {255, 112,   0},
+                        {255, 128,   0}, {255, 144,   0}, {255, 160,   0}, {255, 176,   0}, {255, 192,   0}, {255, 208,   0}, {255, 224,   0}, {255, 240,   0},
+                        {255, 255,   0}, {224, 255,   0}, {192, 255,   0}, {160, 255,   0}, {128, 255,   0}, { 96, 255,   0}, { 64, 255,   0}, { 32, 255,   0},
+                        {  0, 255,   0}, {  0, 255,  36}, {  0, 255,  73}, {  0, 255, 109}, {  0, 255, 146}, {  0, 255, 182}, {  0, 255, 219}, {  0, 255, 255},
+                        {  0, 227, 255}, {  0, 198, 255}, {  0, 170, 255}, {  0, 142, 255}, {  0, 113, 255}, {  0,  85, 255}, {  0,  56, 255}, {  0,  28, 255},
+                        {  0,   0, 255}, { 32,   0, 255}, { 64,   0, 255}, { 96,   0, 255}, {128,   0, 255}, {160,   0, 255}, {192,   0, 255}, {224,   0, 255},
+                        {255,   0, 255}, {255,  32, 255}, {255,  64, 255}, {255,  96, 255}, {255, 128, 255}, {255, 160, 255}, {255, 192, 255}, {255, 224, 255},
+                        {255, 255, 255}, {255, 224, 224}, {255, 192, 192}, {255, 160, 160}, {255, 128, 128}, {255,  96,  96}, {255,  64,  64}, {255,  32,  32},
+                    };
+                    std::shared_ptr<ilda_palette> p(new ilda_palette());
+                    p -> lut.fill(0);
+                    for(std::size_t i = 0 ; i < 64 ; ++i) p -> lut[i] = uint32_t(table[i][0]) << 16 | uint32_t(table[i][1]) << 8 | uint32_t(table[i][2]);
+                    return std::shared_ptr<const ilda_palette>(p);
+                }();
+                return palette;
+            }
+            
+            //entries past count keep the default palette colors
+            static std::shared_ptr<const ilda_palette> from_colors(const std::array<ofColor, 256>& colors, std::size_t count){
+                std::shared_ptr<ilda_palette> p(new ilda_palette(*default_palette()));
+                count = std::min<std::size_t>(count, 256);
+                for(std::size_t i = 0 ; i < count ; ++i) p -> lut[i] = uint32_t(colors[i].r) << 16 | uint32_t(colors[i].g) << 8 | uint32_t(colors[i].b);
+                return p;
+            }
+        };
+        
+        //indexed formats keep the palette index per point. palette is the one in effect when the section was loaded,
+        //the last ColorPalette section before it or the default palette.
+        template<> struct ilda_section<FORMAT::Coordinates3D> : ilda_section_base{
+            std::vector<std::tuple<ofVec3f, uint8_t, uint8_t>> data;
+            std::shared_ptr<const ilda_palette> palette;
+            ofColor color(std::size_t i) const{ return (palette ? palette : ilda_palette::default_palette()) -> color(std::get<2>(data[i])); }
+        };
+        template<> struct ilda_section<FORMAT::Coordinates2D> : ilda_section_base{
+            std::vector<std::tuple<ofVec2f, uint8_t, uint8_t>> data;
+            std::shared_ptr<const ilda_palette> palette;
+            ofColor color(std::size_t i) const{ return (palette ? palette : ilda_palette::default_palette()) -> color(std::get<2>(data[i])); }
+        };
+        template<> struct ilda_section<FORMAT::ColorPalette> : ilda_section_base{
+            std::array<ofColor, 256> data;
+            std::shared_ptr<const ilda_palette> to_palette() const{ return ilda_palette::from_colors(data, number_of_records); }
+        };
+        template<> struct ilda_section<FORMAT::Coordinates3DwTrueColor> : ilda_section_base{
+            std::vector<std::tuple<ofVec3f, uint8_t, ofColor>> data;
+            ofColor color(std::size_t i) const{ return std::get<2>(data[i]); }
+        };
+        template<> struct ilda_section<FORMAT::Coordinates2DwTrueColor> : ilda_section_base{
+            std::vector<std::tuple<ofVec2f, uint8_t, ofColor>> data;
+            ofColor color(std::size_t i) const{ return std::get<2>(data[i]); }
+        };
+        
+        //structure of arrays frame storage, about 11 bytes per point against ~20 for the tuple layouts.
+        //z is left empty for 2D formats. color holds 0x00RRGGBB for true color formats and the palette index for indexed formats.
+        struct packed_section : ilda_section_base{
+            std::vector<int16_t> x;
+            std::vector<int16_t> y;
+            std::vector<int16_t> z;
+            std::vector<uint8_t> status;
+            std::vector<uint32_t> color;
+            
+            std::size_t size() const{ return x.size(); }
+            const bool is_3d() const{ return format == FORMAT::Coordinates3D || format == FORMAT::Coordinates3DwTrueColor; }
+            const bool is_blank(std::size_t i) const{ return status[i] & (1 << 6); }
+            
+            void resize(std::size_t n){
+                x.resize(n);
+                y.resize(n);
+                z.resize(is_3d() ? n : 0);
+                status.resize(n);
+                color.resize(n);
+            }
+            
+            void clear(){ resize(0); }
+            
+            static uint32_t pack_color(const ofColor& c){ return uint32_t(c.r) << 16 | uint32_t(c.g) << 8 | uint32_t(c.b); }
+            static ofColor unpack_color(uint32_t c){ return ofColor((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF); }
+        };
+        
+        //one row of the section offset table. offset points at the "ILDA" magic of the section header.
+        //palette_section is the index of the ColorPalette entry in effect for this section, -1 for the default palette.
+        struct section_entry{
+            uint64_t offset;
+            int32_t palette_section;
+            uint16_t number_of_records;
+            uint8_t format;
+        };
+        
+        //ilda_section<format>, const when base_type is const
+        template<FORMAT format, typename base_type>
+        using section_type = typename std::conditional<std::is_const<base_type>::value, const ilda_section<format>, ilda_section<format>>::type;
+        
+        //calls visitor with the section as its ilda_section<format>. only for sections allocated as ilda_section<format>, not packed_section.
+        template<typename base_type, typename visitor_type>
+        auto visit(base_type& section_base, visitor_type&& visitor) -> decltype(visitor(std::declval<section_type<FORMAT::Coordinates3D, base_type>&>())){
+            static_assert(std::is_same<typename std::remove_const<base_type>::type, ilda_section_base>::value, "visit takes an ilda_section_base");
+            typedef decltype(visitor(std::declval<section_type<FORMAT::Coordinates3D, base_type>&>())) result_type;
+            return dispatch(section_base.format, [&](auto tag) -> result_type {
+                return visitor(static_cast<section_type<decltype(tag)::value, base_type>&>(section_base));
+            });
+        }
+        
+        template<typename T> std::size_t capacity_bytes(const std::vector<T>& data){ return data.capacity() * sizeof(T); }
+        template<typename T, std::size_t N> std::size_t capacity_bytes(const std::array<T, N>& data){ return 0; }
+        
+        //approximate resident size of a decoded section, used for cache budgets.
+        const std::size_t memory_size(const ilda_section_base& section_base){
+            const std::size_t size = visit(section_base, [](const auto& section){ return sizeof(section) + capacity_bytes(section.data); });
+            return size ? size : sizeof(ilda_section_base);
+        }
+        
+        //block conversion between big endian records and native arrays.
+        //one generic shuffle + 8x8 transpose routine covers every point format, with SSSE3 and AVX2 variants selected at runtime.
+        //the scalar path gives bit identical results and is used on other architectures and for the tails.
+        namespace kernels{
+            enum ISA{
+                Scalar = 0,
+                SSSE3 = 1,
+                AVX2 = 2,
+            };
+            
+            template<FORMAT format>
+            void decode_scalar(const uint8_t* src, std::size_t count, int16_t* x, int16_t* y, int16_t* z, uint8_t* status, uint32_t* color){
+                typedef format_traits<format> traits;
+                for(std::size_t i = 0 ; i < count ; ++i, src += traits::record_size){
+                    x[i] = util::read_16b<int16_t>(src);
+                    y[i] = util::read_16b<int16_t>(src + 2);
+                    if(traits::z_offset >= 0 && z) z[i] = util::read_16b<int16_t>(src + traits::z_offset);
+                    const uint8_t* s = src + traits::status_offset;
+                    status[i] = s[0];
+                    color[i] = traits::true_color ? (uint32_t(s[3]) << 16 | uint32_t(s[2]) << 8 | uint32_t(s[1])) : s[1];
+                }
+            }
+            
+            template<FORMAT format>
+            void encode_scalar(const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, uint8_t* dst){
+                typedef format_traits<format> traits;
+                for(std::size_t i = 0 ; i < count ; ++i, dst += traits::record_size){
+                    util::write_16b(dst, x[i]);
+                    util::write_16b(dst + 2, y[i]);
+                    if(traits::z_offset >= 0) util::write_16b(dst + traits::z_offset, int16_t(z ? z[i] : 0));
+                    uint8_t* s = dst + traits::status_offset;
+                    s[0] = status[i];
+                    if(traits::true_color){
+                        s[1] = color[i] & 0xFF;
+                        s[2] = (color[i] >> 8) & 0xFF;
+                        s[3] = (color[i] >> 16) & 0xFF;
+                    }else{
+                        s[1] = color[i];
+                    }
+                }
+            }
+            
+#ifdef OFX_ILDA_SIMD_X86
+            //shuffle masks between one record and a register of 16 bit words [x, y, z, color low, color high, status, 0, 0]
+            //color low is blue | green << 8 (or the palette index), color high is red. [0] decodes, [1] encodes.
+            template<FORMAT format> struct shuffle_masks{};
+            template<> struct shuffle_masks<FORMAT::Coordinates3D>{
+                //x y z status index
+                static const int8_t (&get())[2][16]{
+                    alignas(16) static const int8_t masks[2][16] = {
+                        {1, 0, 3, 2, 5, 4, 7, -1, -1, -1, 6, -1, -1, -1, -1, -1},
+                        {1, 0, 3, 2, 5, 4, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1}};
+                    return masks;
+                }
+            };
+            template<> struct shuffle_masks<FORMAT::Coordinates2D>{
+                //x y status index
+                static const int8_t (&get())[2][16]{
+                    alignas(16) static const int8_t masks[2][16] = {
+                        {1, 0, 3, 2, -1, -1, 5, -1, -1, -1, 4, -1, -1, -1, -1, -1},
+                        {1, 0, 3, 2, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
+                    return masks;
+                }
+            };
+            template<> struct shuffle_masks<FORMAT::Coordinates3DwTrueColor>{
+                //x y z status b g r
+                static const int8_t (&get())[2][16]{
+                    alignas(16) static const int8_t masks[2][16] = {
+                        {1, 0, 3, 2, 5, 4, 7, 8, 9, -1, 6, -1, -1, -1, -1, -1},
+                        {1, 0, 3, 2, 5, 4, 10, 6, 7, 8, -1, -1, -1, -1, -1, -1}};
+                    return masks;
+                }
+            };
+            template<> struct shuffle_masks<FORMAT::Coordinates2DwTrueColor>{
+                //x y status b g r
+                static const int8_t (&get())[2][16]{
+                    alignas(16) static const int8_t masks[2][16] = {
+                        {1, 0, 3, 2, -1, -1, 5, 6, 7, -1, 4, -1, -1, -1, -1, -1},
+                        {1, 0, 3, 2, 10, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1}};
+                    return masks;
+                }
+            };
+            
+            //records are loaded and stored 16 bytes at a time, so a block needs this many records past its last one.
+            template<FORMAT format>
+            constexpr std::size_t block_slack(){
+                return (16 + format_traits<format>::record_size - 1) / format_traits<format>::record_size;
+            }
+            
+            OFX_ILDA_TARGET_SSSE3 void transpose_8x16(__m128i* r){
+                const __m128i t0 = _mm_unpacklo_epi16(r[0], r[1]);
+                const __m128i t1 = _mm_unpackhi_epi16(r[0], r[1]);
+                const __m128i t2 = _mm_unpacklo_epi16(r[2], r[3]);
+                const __m128i t3 = _mm_unpackhi_epi16(r[2], r[3]);
+                const __m128i t4 = _mm_unpacklo_epi16(r[4], r[5]);
+                const __m128i t5 = _mm_unpackhi_epi16(r[4], r[5]);
+                const __m128i t6 = _mm_unpacklo_epi16(r[6], r[7]);
+                const __m128i t7 = _mm_unpackhi_epi16(r[6], r[7]);
+                const __m128i u0 = _mm_unpacklo_epi32(t0, t2);
+                const __m128i u1 = _mm_unpackhi_epi32(t0, t2);
+                const __m128i u2 = _mm_unpacklo_epi32(t1, t3);
+                const __m128i u3 = _mm_unpackhi_epi32(t1, t3);
+                const __m128i u4 = _mm_unpacklo_epi32(t4, t6);
+                const __m128i u5 = _mm_unpackhi_epi32(t4, t6);
+                const __m128i u6 = _mm_unpacklo_epi32(t5, t7);
+                const __m128i u7 = _mm_unpackhi_epi32(t5, t7);
+                r[0] = _mm_unpacklo_epi64(u0, u4);
+                r[1] = _mm_unpackhi_epi64(u0, u4);
+                r[2] = _mm_unpacklo_epi64(u1, u5);
+                r[3] = _mm_unpackhi_epi64(u1, u5);
+                r[4] = _mm_unpacklo_epi64(u2, u6);
+                r[5] = _mm_unpackhi_epi64(u2, u6);
+                r[6] = _mm_unpacklo_epi64(u3, u7);
+                r[7] = _mm_unpackhi_epi64(u3, u7);
+            }
+            
+            template<FORMAT format>
+            OFX_ILDA_TARGET_SSSE3 std::size_t decode_ssse3(const uint8_t* src, std::size_t count, int16_t* x, int16_t* y, int16_t* z, uint8_t* status, uint32_t* color){
+                const __m128i mask = _mm_load_si128((const __m128i*)shuffle_masks<format>::get()[0]);
+                const std::size_t rs = format_traits<format>::record_size;
+                const std::size_t slack = block_slack<format>();
+                std::size_t i = 0;
+                for(; i + 7 + slack <= count ; i += 8){
+                    __m128i r[8];
+                    for(int k = 0 ; k < 8 ; ++k) r[k] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + (i + k) * rs)), mask);
+                    transpose_8x16(r);
+                    _mm_storeu_si128((__m128i*)(x + i), r[0]);
+                    _mm_storeu_si128((__m128i*)(y + i), r[1]);
+                    if(format_traits<format>::z_offset >= 0 && z) _mm_storeu_si128((__m128i*)(z + i), r[2]);
+                    _mm_storeu_si128((__m128i*)(color + i), _mm_unpacklo_epi16(r[3], r[4]));
+                    _mm_storeu_si128((__m128i*)(color + i + 4), _mm_unpackhi_epi16(r[3], r[4]));
+                    _mm_storel_epi64((__m128i*)(status + i), _mm_packus_epi16(r[5], r[5]));
+                }
+                return i;
+            }
+            
+            template<FORMAT format>
+            OFX_ILDA_TARGET_SSSE3 std::size_t encode_ssse3(const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, uint8_t* dst){
+                const __m128i mask = _mm_load_si128((const __m128i*)shuffle_masks<format>::get()[1]);
+                const __m128i split = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, -1, 6, -1, 10, -1, 14, -1);
+                const std::size_t rs = format_traits<format>::record_size;
+                const std::size_t slack = block_slack<format>();
+                std::size_t i = 0;
+                for(; i + 7 + slack <= count ; i += 8){
+                    __m128i r[8];
+                    r[0] = _mm_loadu_si128((const __m128i*)(x + i));
+                    r[1] = _mm_loadu_si128((const __m128i*)(y + i));
+                    r[2] = z ? _mm_loadu_si128((const __m128i*)(z + i)) : _mm_setzero_si128();
+                    const __m128i c0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(color + i)), split);
+                    const __m128i c1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(color + i + 4)), split);
+                    r[3] = _mm_unpacklo_epi64(c0, c1);
+                    r[4] = _mm_unpackhi_epi64(c0, c1);
+                    r[5] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(status + i)), _mm_setzero_si128());
+                    r[6] = r[7] = _mm_setzero_si128();
+                    transpose_8x16(r);
+                    for(int k = 0 ; k < 8 ; ++k) _mm_storeu_si128((__m128i*)(dst + (i + k) * rs), _mm_shuffle_epi8(r[k], mask));
+                }
+                return i;
+            }
+            
+            OFX_ILDA_TARGET_AVX2 void transpose_8x16(__m256i* r){
+                const __m256i t0 = _mm256_unpacklo_epi16(r[0], r[1]);
+                const __m256i t1 = _mm256_unpackhi_epi16(r[0], r[1]);
+                const __m256i t2 = _mm256_unpacklo_epi16(r[2], r[3]);
+                const __m256i t3 = _mm256_unpackhi_epi16(r[2], r[3]);
+                const __m256i t4 = _mm256_unpacklo_epi16(r[4], r[5]);
+                const __m256i t5 = _mm256_unpackhi_epi16(r[4], r[5]);
+                const __m256i t6 = _mm256_unpacklo_epi16(r[6], r[7]);
+                const __m256i t7 = _mm256_unpackhi_epi16(r[6], r[7]);
+                const __m256i u0 = _mm256_unpacklo_epi32(t0, t2);
+                const __m256i u1 = _mm256_unpackhi_epi32(t0, t2);
+                const __m256i u2 = _mm256_unpacklo_epi32(t1, t3);
+                const __m256i u3 = _mm256_unpackhi_epi32(t1, t3);
+                const __m256i u4 = _mm256_unpacklo_epi32(t4, t6);
+                const __m256i u5 = _mm256_unpackhi_epi32(t4, t6);
+                const __m256i u6 = _mm256_unpacklo_epi32(t5, t7);
+                const __m256i u7 = _mm256_unpackhi_epi32(t5, t7);
+                r[0] = _mm256_unpacklo_epi64(u0, u4);
+                r[1] = _mm256_unpackhi_epi64(u0, u4);
+                r[2] = _mm256_unpacklo_epi64(u1, u5);
+                r[3] = _mm256_unpackhi_epi64(u1, u5);
+                r[4] = _mm256_unpacklo_epi64(u2, u6);
+                r[5] = _mm256_unpackhi_epi64(u2, u6);
+                r[6] = _mm256_unpacklo_epi64(u3, u7);
+                r[7] = _mm256_unpackhi_epi64(u3, u7);
+            }
+            
+            //lane 0 carries records i..i+7 and lane 1 records i+8..i+15, so the in-lane transpose above yields contiguous outputs.
+            template<FORMAT format>
+            OFX_ILDA_TARGET_AVX2 std::size_t decode_avx2(const uint8_t* src, std::size_t count, int16_t* x, int16_t* y, int16_t* z, uint8_t* status, uint32_t* color){
+                const __m128i half_mask = _mm_load_si128((const __m128i*)shuffle_masks<format>::get()[0]);
+                const __m256i mask = _mm256_inserti128_si256(_mm256_castsi128_si256(half_mask), half_mask, 1);
+                const std::size_t rs = format_traits<format>::record_size;
+                const std::size_t slack = block_slack<format>();
+                std::size_t i = 0;
+                for(; i + 15 + slack <= count ; i += 16){
+                    __m256i r[8];
+                    for(int k = 0 ; k < 8 ; ++k){
+                        const __m128i lo = _mm_loadu_si128((const __m128i*)(src + (i + k) * rs));
+                        const __m128i hi = _mm_loadu_si128((const __m128i*)(src + (i + k + 8) * rs));
+                        r[k] = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), mask);
+                    }
+                    transpose_8x16(r);
+                    _mm256_storeu_si256((__m256i*)(x + i), r[0]);
+                    _mm256_storeu_si256((__m256i*)(y + i), r[1]);
+                    if(format_traits<format>::z_offset >= 0 && z) _mm256_storeu_si256((__m256i*)(z + i), r[2]);
+                    const __m256i c0 = _mm256_unpacklo_epi16(r[3], r[4]);
+                    const __m256i c1 = _mm256_unpackhi_epi16(r[3], r[4]);
+                    _mm256_storeu_si256((__m256i*)(color + i), _mm256_permute2x128_si256(c0, c1, 0x20));
+                    _mm256_storeu_si256((__m256i*)(color + i + 8), _mm256_permute2x128_si256(c0, c1, 0x31));
+                    const __m256i s = _mm256_packus_epi16(r[5], r[5]);
+                    _mm_storel_epi64((__m128i*)(status + i), _mm256_castsi256_si128(s));
+                    _mm_storel_epi64((__m128i*)(status + i + 8), _mm256_extracti128_si256(s, 1));
+                }
+                return i;
+            }
+            
+            template<FORMAT format>
+            OFX_ILDA_TARGET_AVX2 std::size_t encode_avx2(const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, uint8_t* dst){
+                const __m128i half_mask = _mm_load_si128((const __m128i*)shuffle_masks<format>::get()[1]);
+                const __m256i mask = _mm256_inserti128_si256(_mm256_castsi128_si256(half_mask), half_mask, 1);
+                const __m256i split = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, -1, 6, -1, 10, -1, 14, -1,
+                                                       0, 1, 4, 5, 8, 9, 12, 13, 2, -1, 6, -1, 10, -1, 14, -1);
+                const std::size_t rs = format_traits<format>::record_size;
+                const std::size_t slack = block_slack<format>();
+                std::size_t i = 0;
+                for(; i + 15 + slack <= count ; i += 16){
+                    __m256i r[8];
+                    r[0] = _mm256_loadu_si256((const __m256i*)(x + i));
+                    r[1] = _mm256_loadu_si256((const __m256i*)(y + i));
+                    r[2] = z ? _mm256_loadu_si256((const __m256i*)(z + i)) : _mm256_setzero_si256();
+                    const __m256i a = _mm256_loadu_si256((const __m256i*)(color + i));
+                    const __m256i b = _mm256_loadu_si256((const __m256i*)(color + i + 8));
+                    const __m256i c0 = _mm256_shuffle_epi8(_mm256_permute2x128_si256(a, b, 0x20), split);
+                    const __m256i c1 = _mm256_shuffle_epi8(_mm256_permute2x128_si256(a, b, 0x31), split);
+                    r[3] = _mm256_unpacklo_epi64(c0, c1);
+                    r[4] = _mm256_unpackhi_epi64(c0, c1);
+                    r[5] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(status + i)));
+                    r[6] = r[7] = _mm256_setzero_si256();
+                    transpose_8x16(r);
+                    for(int k = 0 ; k < 8 ; ++k){
+                        _mm_storeu_si128((__m128i*)(dst + (i + k) * rs), _mm256_castsi256_si128(_mm256_shuffle_epi8(r[k], mask)));
+                    }
+                    for(int k = 0 ; k < 8 ; ++k){
+                        _mm_storeu_si128((__m128i*)(dst + (i + k + 8) * rs), _mm256_extracti128_si256(_mm256_shuffle_epi8(r[k], mask), 1));
+                    }
+                }
+                return i;
+            }
+#endif
+            
+#ifdef OFX_ILDA_SIMD_X86
+            OFX_ILDA_TARGET_AVX2 std::size_t resolve_palette_avx2(const uint32_t* lut, const uint32_t* index, std::size_t count, uint32_t* color){
+                const __m256i mask = _mm256_set1_epi32(0xFF);
+                std::size_t i = 0;
+                for(; i + 8 <= count ; i += 8){
+                    const __m256i idx = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(index + i)), mask);
+                    _mm256_storeu_si256((__m256i*)(color + i), _mm256_i32gather_epi32((const int*)lut, idx, 4));
+                }
+                return i;
+            }
+#endif
+            
+#ifdef OFX_ILDA_SIMD_X86
+            OFX_ILDA_TARGET_AVX2 __m256 load_float_avx2(const int16_t* src){
+                return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)src)));
+            }
+            
+            OFX_ILDA_TARGET_AVX2 std::size_t segment_lengths_avx2(const int16_t* x, const int16_t* y, const int16_t* z, std::size_t count, float* length){
+                std::size_t i = 0;
+                for(; i + 9 <= count ; i += 8){
+                    const __m256 dx = _mm256_sub_ps(load_float_avx2(x + i + 1), load_float_avx2(x + i));
+                    const __m256 dy = _mm256_sub_ps(load_float_avx2(y + i + 1), load_float_avx2(y + i));
+                    __m256 sum = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+                    if(z){
+                        const __m256 dz = _mm256_sub_ps(load_float_avx2(z + i + 1), load_float_avx2(z + i));
+                        sum = _mm256_add_ps(sum, _mm256_mul_ps(dz, dz));
+                    }
+                    _mm256_storeu_ps(length + i, _mm256_sqrt_ps(sum));
+                }
+                return i;
+            }
+            
+            //one 32 bit gather at v + index reads v[index] into the low half and v[index + 1] into the high half
+            OFX_ILDA_TARGET_AVX2 __m256i lerp_16_avx2(const int16_t* v, __m256i index, __m256 t){
+                const __m256i pair = _mm256_i32gather_epi32((const int*)v, index, 2);
+                const __m256 a = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(pair, 16), 16));
+                const __m256 b = _mm256_cvtepi32_ps(_mm256_srai_epi32(pair, 16));
+                return _mm256_cvtps_epi32(_mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t)));
+            }
+            
+            OFX_ILDA_TARGET_AVX2 void store_16_avx2(int16_t* dst, __m256i v){
+                const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(v, v), 0x08);
+                _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+            }
+            
+            OFX_ILDA_TARGET_AVX2 std::size_t interpolate_avx2(const int16_t* x, const int16_t* y, const int16_t* z, const uint32_t* color, bool blend_color, const uint32_t* index, const float* t, std::size_t count, int16_t* out_x, int16_t* out_y, int16_t* out_z, uint32_t* out_color){
+                const __m256i channel = _mm256_set1_epi32(0xFF);
+                const __m256 half = _mm256_set1_ps(0.5f);
+                std::size_t i = 0;
+                for(; i + 8 <= count ; i += 8){
+                    const __m256i idx = _mm256_loadu_si256((const __m256i*)(index + i));
+                    const __m256 w = _mm256_loadu_ps(t + i);
+                    store_16_avx2(out_x + i, lerp_16_avx2(x, idx, w));
+                    store_16_avx2(out_y + i, lerp_16_avx2(y, idx, w));
+                    if(z) store_16_avx2(out_z + i, lerp_16_avx2(z, idx, w));
+                    const __m256i ca = _mm256_i32gather_epi32((const int*)color, idx, 4);
+                    const __m256i cb = _mm256_i32gather_epi32((const int*)(color + 1), idx, 4);
+                    __m256i c;
+                    if(blend_color){
+                        c = _mm256_setzero_si256();
+                        for(int shift = 0 ; shift < 24 ; shift += 8){
+                            const __m256 a = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(ca, shift), channel));
+                            const __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(cb, shift), channel));
+                            const __m256i v = _mm256_cvtps_epi32(_mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), w)));
+                            c = _mm256_or_si256(c, _mm256_slli_epi32(v, shift));
+                        }
+                    }else{
+                        c = _mm256_blendv_epi8(cb, ca, _mm256_castps_si256(_mm256_cmp_ps(w, half, _CMP_LT_OQ)));
+                    }
+                    _mm256_storeu_si256((__m256i*)(out_color + i), c);
+                }
+                return i;
+            }
+#endif
+            
+            ISA detect_isa(){
+#ifdef OFX_ILDA_SIMD_X86
+#if defined(_MSC_VER)
+                int info[4];
+                __cpuid(info, 0);
+                const int max_leaf = info[0];
+                __cpuid(info, 1);
+                const bool ssse3 = (info[2] & (1 << 9)) != 0;
+                const bool osxsave = (info[2] & (1 << 27)) != 0;
+                bool avx2 = false;
+                if(max_leaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6){
+                    __cpuidex(info, 7, 0);
+                    avx2 = (info[1] & (1 << 5)) != 0;
+                }
+                if(avx2) return ISA::AVX2;
+                if(ssse3) return ISA::SSSE3;
+#else
+                __builtin_cpu_init();
+                if(__builtin_cpu_supports("avx2")) return ISA::AVX2;
+                if(__builtin_cpu_supports("ssse3")) return ISA::SSSE3;
+#endif
+#endif
+                return ISA::Scalar;
+            }
+            
+            std::atomic<int>& isa_state(){
+                static std::atomic<int> isa{detect_isa()};
+                return isa;
+            }
+            
+            ISA get_isa(){
+                return (ISA)isa_state().load(std::memory_order_relaxed);
+            }
+            
+            //restricts the kernels to isa or lower. requests above what the cpu supports are clamped.
+            void set_isa(ISA isa){
+                isa_state().store(std::min<int>(isa, detect_isa()));
+            }
+            
+            //count big endian records -> arrays. z may be null for 2D formats. indexed formats store the palette index in color.
+            template<FORMAT format>
+            const bool decode(const uint8_t* src, std::size_t count, int16_t* x, int16_t* y, int16_t* z, uint8_t* status, uint32_t* color){
+                const std::size_t rs = format_traits<format>::record_size;
+                std::size_t done = 0;
+#ifdef OFX_ILDA_SIMD_X86
+                const ISA isa = get_isa();
+                if(isa >= ISA::AVX2) done = decode_avx2<format>(src, count, x, y, z, status, color);
+                if(isa >= ISA::SSSE3) done += decode_ssse3<format>(src + done * rs, count - done, x + done, y + done, z ? z + done : z, status + done, color + done);
+#endif
+                decode_scalar<format>(src + done * rs, count - done, x + done, y + done, z ? z + done : z, status + done, color + done);
+                return true;
+            }
+            
+            //arrays -> count big endian records. a null z writes 0 for 3D formats.
+            template<FORMAT format>
+            const bool encode(const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, uint8_t* dst){
+                const std::size_t rs = format_traits<format>::record_size;
+                std::size_t done = 0;
+#ifdef OFX_ILDA_SIMD_X86
+                const ISA isa = get_isa();
+                if(isa >= ISA::AVX2) done = encode_avx2<format>(x, y, z, status, color, count, dst);
+                if(isa >= ISA::SSSE3) done += encode_ssse3<format>(x + done, y + done, z ? z + done : z, status + done, color + done, count - done, dst + done * rs);
+#endif
+                encode_scalar<format>(x + done, y + done, z ? z + done : z, status + done, color + done, count - done, dst + done * rs);
+                return true;
+            }
+            
+            //palettes have no point records
+            template<> const bool decode<FORMAT::ColorPalette>(const uint8_t* src, std::size_t count, int16_t* x, int16_t* y, int16_t* z, uint8_t* status, uint32_t* color){ return false; }
+            template<> const bool encode<FORMAT::ColorPalette>(const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, uint8_t* dst){ return false; }
+            
+            const bool decode(FORMAT format, const uint8_t* src, std::size_t count, int16_t* x, int16_t* y, int16_t* z, uint8_t* status, uint32_t* color){
+                return dispatch(format, [&](auto tag){ return decode<decltype(tag)::value>(src, count, x, y, z, status, color); });
+            }
+            
+            //palette indices -> 0x00RRGGBB through a 256 entry table. index and color may be the same array.
+            void resolve_palette(const uint32_t* lut, const uint32_t* index, std::size_t count, uint32_t* color){
+                std::size_t done = 0;
+#ifdef OFX_ILDA_SIMD_X86
+                if(get_isa() >= ISA::AVX2) done = resolve_palette_avx2(lut, index, count, color);
+#endif
+                for(std::size_t i = done ; i < count ; ++i) color[i] = lut[index[i] & 0xFF];
+            }
+            
+            const bool encode(FORMAT format, const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, uint8_t* dst){
+                return dispatch(format, [&](auto tag){ return encode<decltype(tag)::value>(x, y, z, status, color, count, dst); });
+            }
+            
+            //length[i] = distance from point i to point i + 1, count - 1 values. z may be null.
+            void segment_lengths(const int16_t* x, const int16_t* y, const int16_t* z, std::size_t count, float* length){
+                if(count < 2) return;
+                std::size_t done = 0;
+#ifdef OFX_ILDA_SIMD_X86
+                if(get_isa() >= ISA::AVX2) done = segment_lengths_avx2(x, y, z, count, length);
+#endif
+                for(std::size_t i = done ; i + 1 < count ; ++i){
+                    const float dx = float(x[i + 1]) - float(x[i]);
+                    const float dy = float(y[i + 1]) - float(y[i]);
+                    float sum = dx * dx + dy * dy;
+                    if(z){
+                        const float dz = float(z[i + 1]) - float(z[i]);
+                        sum = sum + dz * dz;
+                    }
+                    length[i] = std::sqrt(sum);
+                }
+            }
+            
+            //out[i] = in[index[i]] + (in[index[i] + 1] - in[index[i]]) * t[i], rounded to nearest. index[i] + 1 must be a valid point.
+            //colors are blended per channel, or taken from the nearer point when blend_color is false (palette indices).
+            void interpolate(const int16_t* x, const int16_t* y, const int16_t* z, const uint32_t* color, bool blend_color, const uint32_t* index, const float* t, std::size_t count, int16_t* out_x, int16_t* out_y, int16_t* out_z, uint32_t* out_color){
+                std::size_t done = 0;
+#ifdef OFX_ILDA_SIMD_X86
+                if(get_isa() >= ISA::AVX2) done = interpolate_avx2(x, y, z, color, blend_color, index, t, count, out_x, out_y, out_z, out_color);
+#endif
+                auto lerp = [](float a, float b, float w){ return int32_t(std::nearbyint(a + (b - a) * w)); };
+                for(std::size_t i = done ; i < count ; ++i){
+                    const uint32_t j = index[i];
+                    const float w = t[i];
+                    out_x[i] = lerp(x[j], x[j + 1], w);
+                    out_y[i] = lerp(y[j], y[j + 1], w);
+                    if(z) out_z[i] = lerp(z[j], z[j + 1], w);
+                    if(blend_color){
+                        uint32_t c = 0;
+                        for(int shift = 0 ; shift < 24 ; shift += 8) c |= uint32_t(lerp((color[j] >> shift) & 0xFF, (color[j + 1] >> shift) & 0xFF, w)) << shift;
+                        out_color[i] = c;
+                    }else{
+                        out_color[i] = w < 0.5f ? color[j] : color[j + 1];
+                    }
+                }
+            }
+        };
+        
+        //record codec of ilda_section<format>. point records go through the kernels in fixed blocks, then into the tuple layout.
+        template<FORMAT format>
+        struct codec{
+            typedef format_traits<format> traits;
+            
+            //decode count big endian records from src and append them to section.data
+            static void decode(ilda_section<format>& section, const uint8_t* src, std::size_t count){
+                const std::size_t block = 256;
+                int16_t x[block], y[block], z[block];
+                uint8_t status[block];
+                uint32_t color[block];
+                int16_t* z_ptr = traits::dimensions == 3 ? z : nullptr;
+                auto& data = section.data;
+                data.reserve(data.size() + count);
+                for(std::size_t first = 0 ; first < count ; first += block, src += block * traits::record_size){
+                    const std::size_t n = std::min(block, count - first);
+                    kernels::decode<format>(src, n, x, y, z_ptr, status, color);
+                    for(std::size_t i = 0 ; i < n ; ++i){
+                        data.emplace_back();
+                        auto& d = data.back();
+                        util::set_point(std::get<0>(d), x[i], y[i], z_ptr ? z[i] : 0);
+                        std::get<1>(d) = status[i];
+                        util::set_color(std::get<2>(d), color[i]);
+                    }
+                }
+            }
+            
+            //encode the first count points of section.data as big endian records into dst
+            static void encode(const ilda_section<format>& section, uint8_t* dst, std::size_t count){
+                const std::size_t block = 256;
+                int16_t x[block], y[block], z[block];
+                uint8_t status[block];
+                uint32_t color[block];
+                for(std::size_t first = 0 ; first < count ; first += block, dst += block * traits::record_size){
+                    const std::size_t n = std::min(block, count - first);
+                    for(std::size_t i = 0 ; i < n ; ++i){
+                        const auto& d = section.data[first + i];
+                        const ofVec3f pos(std::get<0>(d));
+                        x[i] = pos.x;
+                        y[i] = pos.y;
+                        z[i] = pos.z;
+                        status[i] = std::get<1>(d);
+                        color[i] = util::get_color(std::get<2>(d));
+                    }
+                    kernels::encode<format>(x, y, traits::dimensions == 3 ? z : nullptr, status, color, n, dst);
+                }
+            }
+        };
+        
+        template<>
+        struct codec<FORMAT::ColorPalette>{
+            static void decode(ilda_section<FORMAT::ColorPalette>& section, const uint8_t* src, std::size_t count){
+                count = std::min<std::size_t>(count, section.data.size());
+                for(std::size_t i = 0 ; i < count ; ++i, src += 3){
+                    section.data[i].set(src[0], src[1], src[2]);
+                }
+            }
+            
+            static void encode(const ilda_section<FORMAT::ColorPalette>& section, uint8_t* dst, std::size_t count){
+                for(std::size_t i = 0 ; i < count ; ++i, dst += 3){
+                    dst[0] = section.data[i].r;
+                    dst[1] = section.data[i].g;
+                    dst[2] = section.data[i].b;
+                }
+            }
+        };
+        
+        //content addressed store of immutable point buffers. callers opt in by keeping the buffer intern returns
+        //instead of their own vector, identical contents then share one allocation. the store only keeps weak references,
+        //so a buffer is freed with its last holder. thread safe, returned buffers are never modified.
+        struct frame_store{
+            //the stored buffer equal to data, or data itself after registering it
+            template<typename T>
+            std::shared_ptr<const std::vector<T>> intern(std::vector<T> data){
+                if(data.empty()) return std::make_shared<const std::vector<T>>();
+                const uint64_t key = hash(data);
+                const void* type = type_id<T>();
+                std::lock_guard<std::mutex> lock(mutex);
+                ++num_frames;
+                auto range = entries.equal_range(key);
+                for(auto it = range.first ; it != range.second ; ++it){
+                    if(it -> second.type != type) continue;
+                    std::shared_ptr<const std::vector<T>> other = std::static_pointer_cast<const std::vector<T>>(it -> second.buffer.lock());
+                    if(!other) continue;
+                    if(other -> size() == data.size() && std::equal(other -> begin(), other -> end(), data.begin(), [](const T& a, const T& b){ return equal_element(a, b); })){
+                        ++num_shared;
+                        bytes_saved += data.capacity() * sizeof(T);
+                        return other;
+                    }
+                }
+                std::shared_ptr<const std::vector<T>> buffer = std::make_shared<const std::vector<T>>(std::move(data));
+                if(entries.size() >= prune_size) prune();
+                entries.emplace(key, entry{type, buffer});
+                return buffer;
+            }
+            
+            //counts a point section loaded with duplicate detection, duplicate when it was copied from a byte identical
+            //section of the same file instead of decoded. sections own their data, so no bytes are saved.
+            void count_loaded(bool duplicate){
+                std::lock_guard<std::mutex> lock(mutex);
+                ++num_frames;
+                if(duplicate) ++num_shared;
+            }
+            
+            uint64_t get_num_frames() const{ std::lock_guard<std::mutex> lock(mutex); return num_frames; }
+            uint64_t get_num_shared() const{ std::lock_guard<std::mutex> lock(mutex); return num_shared; }
+            uint64_t get_bytes_saved() const{ std::lock_guard<std::mutex> lock(mutex); return bytes_saved; }
+            
+            //frames seen / distinct buffers among them, 1 without duplicates
+            double get_dedup_ratio() const{
+                std::lock_guard<std::mutex> lock(mutex);
+                return num_frames == num_shared ? 1.0 : double(num_frames) / double(num_frames - num_shared);
+            }
+            
+            void clear(){
+                std::lock_guard<std::mutex> lock(mutex);
+                entries.clear();
+                num_frames = num_shared = bytes_saved = 0;
+                prune_size = 1024;
+            }
+            
+        private:
+            struct entry{
+                const void* type;
+                std::weak_ptr<const void> buffer;
+            };
+            
+            template<typename T> static const void* type_id(){
+                static const char id = 0;
+                return &id;
+            }
+            
+            static uint64_t mix(uint64_t h, uint64_t value){
+                h = (h ^ value) * 0x9E3779B97F4A7C15ULL;
+                return h ^ (h >> 29);
+            }
+            
+            static uint64_t float_bits(float value){
+                uint32_t bits;
+                std::memcpy(&bits, &value, 4);
+                return bits;
+            }
+            
+            template<typename point_type, typename color_type>
+            static uint64_t hash_element(uint64_t h, const std::tuple<point_type, uint8_t, color_type>& d){
+                const ofVec3f p(std::get<0>(d));
+                h = mix(h, float_bits(p.x) << 32 | float_bits(p.y));
+                return mix(h, float_bits(p.z) << 32 | uint64_t(std::get<1>(d)) << 24 | util::get_color(std::get<2>(d)));
+            }
+            
+            template<typename T>
+            static const bool equal_element(const T& a, const T& b){ return a == b; }
+            
+#ifdef OFX_ILDA_CONVERT
+            static uint64_t hash_element(uint64_t h, const ofxIlda::Point& p){
+                h = mix(h, uint64_t(uint16_t(p.x)) | uint64_t(uint16_t(p.y)) << 16 | uint64_t(p.r) << 32 | uint64_t(p.g) << 48);
+                return mix(h, uint64_t(p.b) | uint64_t(p.a) << 16);
+            }
+            
+            static const bool equal_element(const ofxIlda::Point& a, const ofxIlda::Point& b){
+                return a.x == b.x && a.y == b.y && a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+            }
+#endif
+            
+            template<typename T>
+            static uint64_t hash(const std::vector<T>& data){
+                uint64_t h = mix(0, data.size());
+                for(const auto& d : data) h = hash_element(h, d);
+                return h;
+            }
+            
+            //drops entries whose buffer is gone
+            void prune(){
+                for(auto it = entries.begin() ; it != entries.end() ;){
+                    if(it -> second.buffer.expired()) it = entries.erase(it);
+                    else ++it;
+                }
+                prune_size = std::max<std::size_t>(1024, entries.size() * 2);
+            }
+            
+            mutable std::mutex mutex;
+            std::unordered_multimap<uint64_t, entry> entries;
+            std::size_t prune_size = 1024;
+            uint64_t num_frames = 0;
+            uint64_t num_shared = 0;
+            uint64_t bytes_saved = 0;
+        };
+        
+        namespace load_functions{
+            namespace commons{
+                const std::size_t header_size = header_layout::size;
+                const std::size_t stream_chunk_size = 1 << 14;
+                
+                const bool read_ilda(std::ifstream& ifs){
+                    char head[5];
+                    head[4] = '\0';
+                    ifs.read((char*)&head,4);
+                    return (strncmp(head,"ILDA",4) == 0);
+                }
+                
+                const bool read_ilda(const uint8_t* src){
+                    return (strncmp((const char*)src,"ILDA",4) == 0);
+                }
+                
+                const std::size_t record_size(FORMAT format){
+                    return dispatch(format, [](auto tag) -> std::size_t { return format_traits<decltype(tag)::value>::record_size; });
+                }
+                
+                void read_header(ilda_section_base& section_base, const uint8_t* src){
+                    const char* name_buf = reinterpret_cast<const char*>(src) + header_layout::name;
+                    section_base.name = std::string(name_buf, std::find(name_buf, name_buf + header_layout::name_length, '\0'));
+                    name_buf = reinterpret_cast<const char*>(src) + header_layout::company_name;
+                    section_base.company_name = std::string(name_buf, std::find(name_buf, name_buf + header_layout::name_length, '\0'));
+                    section_base.number_of_records = util::read_16b<uint16_t>(src + header_layout::number_of_records);
+                    section_base.frame_number = util::read_16b<uint16_t>(src + header_layout::frame_number);
+                    section_base.total_frames = util::read_16b<uint16_t>(src + header_layout::total_frames);
+                    section_base.projector_number = src[header_layout::projector_number];
+                    section_base.none = src[header_layout::none];
+                }
+                
+                //allocates the section matching the format byte of a 32 byte header and fills the header fields.
+                const bool create_section(std::shared_ptr<ilda_section_base>& section_base, const uint8_t* header){
+                    const FORMAT type = static_cast<FORMAT>(header[header_layout::format]);
+                    const bool known = dispatch(type, [&](auto tag){
+                        section_base.reset(new ilda_section<decltype(tag)::value>());
+                        return true;
+                    });
+                    if(!known){
+                        ofLogWarning("ofxIldaFile") << "unknown format " << (int)header[header_layout::format];
+                        section_base.reset();
+                        return false;
+                    }
+                    section_base -> format = type;
+                    read_header(*section_base, header);
+                    if(type == FORMAT::ColorPalette && section_base -> number_of_records > 256){
+                        ofLogWarning("ofxIldaFile") << "palette with " << section_base -> number_of_records << " colors, keep 256";
+                        section_base -> number_of_records = 256;
+                    }
+                    return true;
+                }
+            };
+            
+            //decode count big endian records from src and append them to section.data
+            template<FORMAT format> void type_load(ilda_section<format>& section, const uint8_t* src, std::size_t count){
+                codec<format>::decode(section, src, count);
+            }
+            
+            //sets the palette of an indexed section, other formats are left untouched.
+            void set_palette(ilda_section_base& section_base, const std::shared_ptr<const ilda_palette>& palette){
+                if(section_base.format == FORMAT::Coordinates3D) static_cast<ilda_section<FORMAT::Coordinates3D>&>(section_base).palette = palette;
+                if(section_base.format == FORMAT::Coordinates2D) static_cast<ilda_section<FORMAT::Coordinates2D>&>(section_base).palette = palette;
+            }
+            
+            std::shared_ptr<const ilda_palette> get_palette(const ilda_section_base& section_base){
+                std::shared_ptr<const ilda_palette> palette;
+                if(section_base.format == FORMAT::Coordinates3D) palette = static_cast<const ilda_section<FORMAT::Coordinates3D>&>(section_base).palette;
+                if(section_base.format == FORMAT::Coordinates2D) palette = static_cast<const ilda_section<FORMAT::Coordinates2D>&>(section_base).palette;
+                return palette ? palette : ilda_palette::default_palette();
+            }
+            
+            //applies each ColorPalette section to the indexed sections following it, in file order starting at first.
+            void assign_palettes(std::vector<std::shared_ptr<ilda_section_base>>& sections, std::size_t first = 0){
+                std::shared_ptr<const ilda_palette> palette = ilda_palette::default_palette();
+                for(std::size_t i = first ; i < sections.size() ; ++i){
+                    if(!sections[i]) continue;
+                    if(sections[i] -> format == FORMAT::ColorPalette){
+                        palette = static_cast<const ilda_section<FORMAT::ColorPalette>&>(*sections[i]).to_palette();
+                    }else{
+                        set_palette(*sections[i], palette);
+                    }
+                }
+            }
+            
+            void load_records(std::shared_ptr<ilda_section_base>& section_base, const uint8_t* src, std::size_t count){
+                visit(*section_base, [&](auto& section){ type_load(section, src, count); });
+            }
+            
+            //walks the file header to header using number_of_records * record size.
+            //when the expected magic is missing the walk resyncs on the next "ILDA" found after that point.
+            //the end of file section (0 records) is kept in the table and ends the walk unless another header follows directly.
+            //skipped counts resyncs and headers of unknown format.
+            void build_index(const uint8_t* bytes, std::size_t size, std::vector<section_entry>& index, uint64_t* skipped = nullptr){
+                static const char magic[] = "ILDA";
+                int32_t palette_section = -1;
+                std::size_t offset = 0;
+                while(offset + commons::header_size <= size){
+                    if(!commons::read_ilda(bytes + offset)){
+                        const uint8_t* found = std::search(bytes + offset + 1, bytes + size, magic, magic + 4);
+                        if(found == bytes + size) break;
+                        ofLogWarning("ofxIldaFile") << "no header at " << offset << ", resync " << (found - bytes - offset) << " bytes";
+                        if(skipped) ++*skipped;
+                        offset = found - bytes;
+                        continue;
+                    }
+                    const uint8_t* header = bytes + offset;
+                    const std::size_t record_size = commons::record_size((FORMAT)header[header_layout::format]);
+                    if(record_size == 0){
+                        ofLogWarning("ofxIldaFile") << "unknown format " << (int)header[header_layout::format] << " at " << offset;
+                        if(skipped) ++*skipped;
+                        offset += 4;
+                        continue;
+                    }
+                    section_entry entry;
+                    entry.offset = offset;
+                    entry.palette_section = palette_section;
+                    entry.number_of_records = util::read_16b<uint16_t>(header + header_layout::number_of_records);
+                    entry.format = header[header_layout::format];
+                    if(entry.format == FORMAT::ColorPalette) palette_section = index.size();
+                    index.push_back(entry);
+                    offset += commons::header_size + entry.number_of_records * record_size;
+                    if(entry.number_of_records == 0 && !(offset + 4 <= size && commons::read_ilda(bytes + offset))) break;
+                }
+            }
+            
+            //same walk as the mapped version, reading only the 32 byte headers and seeking over the records.
+            void build_index(std::ifstream& ifs, std::vector<section_entry>& index, uint64_t* skipped = nullptr){
+                ifs.clear();
+                ifs.seekg(0, std::ios_base::end);
+                const uint64_t size = ifs.tellg();
+                int32_t palette_section = -1;
+                uint64_t offset = 0;
+                uint8_t header[commons::header_size];
+                std::array<uint8_t, commons::stream_chunk_size> chunk;
+                while(offset + commons::header_size <= size){
+                    ifs.clear();
+                    ifs.seekg(offset, std::ios_base::beg);
+                    ifs.read((char*)header, commons::header_size);
+                    if(!commons::read_ilda(header)){
+                        //resync : scan forward chunk by chunk, overlapping 3 bytes so a split magic is still found.
+                        uint64_t search = offset + 1;
+                        bool found = false;
+                        while(!found && search + 4 <= size){
+                            ifs.clear();
+                            ifs.seekg(search, std::ios_base::beg);
+                            ifs.read((char*)chunk.data(), chunk.size());
+                            const std::size_t count = ifs.gcount();
+                            if(count < 4) break;
+                            for(std::size_t i = 0 ; i + 4 <= count ; ++i){
+                                if(commons::read_ilda(chunk.data() + i)){
+                                    search += i;
+                                    found = true;
+                                    break;
+                                }
+                            }
+                            if(!found) search += count - 3;
+                        }
+                        if(!found) break;
+                        ofLogWarning("ofxIldaFile") << "no header at " << offset << ", resync " << (search - offset) << " bytes";
+                        if(skipped) ++*skipped;
+                        offset = search;
+                        continue;
+                    }
+                    const std::size_t record_size = commons::record_size((FORMAT)header[header_layout::format]);
+                    if(record_size == 0){
+                        ofLogWarning("ofxIldaFile") << "unknown format " << (int)header[header_layout::format] << " at " << offset;
+                        if(skipped) ++*skipped;
+                        offset += 4;
+                        continue;
+                    }
+                    section_entry entry;
+                    entry.offset = offset;
+                    entry.palette_section = palette_section;
+                    entry.number_of_records = util::read_16b<uint16_t>(header + header_layout::number_of_records);
+                    entry.format = header[header_layout::format];
+                    if(entry.format == FORMAT::ColorPalette) palette_section = index.size();
+                    index.push_back(entry);
+                    offset += commons::header_size + entry.number_of_records * record_size;
+                    if(entry.number_of_records == 0){
+                        char next[4] = {0, 0, 0, 0};
+                        ifs.clear();
+                        ifs.seekg(offset, std::ios_base::beg);
+                        ifs.read(next, 4);
+                        if(ifs.gcount() != 4 || strncmp(next, "ILDA", 4) != 0) break;
+                    }
+                }
+                ifs.clear();
+                ifs.seekg(0, std::ios_base::beg);
+            }
+            
+            //decode a section straight from mapped bytes. size is the number of bytes available from src.
+            const bool load_section(std::shared_ptr<ilda_section_base>& section_base, const uint8_t* src, std::size_t size){
+                if(size < commons::header_size || !commons::read_ilda(src)) return false;
+                if(!commons::create_section(section_base, src)) return false;
+                const std::size_t record_size = commons::record_size(section_base -> format);
+                std::size_t count = section_base -> number_of_records;
+                if(commons::header_size + count * record_size > size){
+                    count = (size - commons::header_size) / record_size;
+                    ofLogWarning("ofxIldaFile") << "truncated section, records " << section_base -> number_of_records << " -> " << count;
+                    section_base -> number_of_records = count;
+                }
+                load_records(section_base, src + commons::header_size, count);
+                return true;
+            }
+            
+            //stream fallback. records are pulled through a fixed size chunk and decoded with the same functions as the mapped path.
+            const bool load_section(std::shared_ptr<ilda_section_base>& section_base, std::ifstream& ifs){
+                uint8_t header[commons::header_size];
+                ifs.read((char*)header, commons::header_size);
+                if(ifs.gcount() != commons::header_size || !commons::read_ilda(header)) return false;
+                if(!commons::create_section(section_base, header)) return false;
+                
+                const std::size_t record_size = commons::record_size(section_base -> format);
+                const std::size_t chunk_records = commons::stream_chunk_size / record_size;
+                std::array<uint8_t, commons::stream_chunk_size> chunk;
+                std::size_t loaded = 0;
+                while(loaded < section_base -> number_of_records){
+                    const std::size_t request = std::min<std::size_t>(section_base -> number_of_records - loaded, chunk_records);
+                    ifs.read((char*)chunk.data(), request * record_size);
+                    const std::size_t count = ifs.gcount() / record_size;
+                    load_records(section_base, chunk.data(), count);
+                    loaded += count;
+                    if(count < request){
+                        ofLogWarning("ofxIldaFile") << "truncated section, records " << section_base -> number_of_records << " -> " << loaded;
+                        section_base -> number_of_records = loaded;
+                        break;
+                    }
+                }
+                return true;
+            }
+            
+            //finds point sections of a mapped file whose records are byte identical to an earlier section,
+            //they are created with a copy of that section's data instead of being decoded again.
+            struct duplicate_finder{
+                duplicate_finder(const uint8_t* bytes, std::size_t size) : bytes(bytes), size(size){}
+                
+                const bool find(const section_entry& entry, std::shared_ptr<ilda_section_base>& section){
+                    std::size_t length;
+                    if(!records_length(entry, length)) return false;
+                    const uint8_t* records = bytes + entry.offset + commons::header_size;
+                    auto range = seen.equal_range(util::hash_bytes(records, length));
+                    for(auto it = range.first ; it != range.second ; ++it){
+                        const section_entry& other = it -> second.first;
+                        const ilda_section_base& source = *it -> second.second;
+                        if(other.format != entry.format || other.number_of_records != entry.number_of_records) continue;
+                        if(std::memcmp(records, bytes + other.offset + commons::header_size, length) != 0) continue;
+                        if(!commons::create_section(section, bytes + entry.offset)) return false;
+                        visit(*section, [&](auto& copy){
+                            typedef typename std::remove_reference<decltype(copy)>::type section_type;
+                            copy.data = static_cast<const section_type&>(source).data;
+                        });
+                        return true;
+                    }
+                    return false;
+                }
+                
+                void add(const section_entry& entry, const std::shared_ptr<ilda_section_base>& section){
+                    std::size_t length;
+                    if(!records_length(entry, length) || section -> number_of_records != entry.number_of_records) return;
+                    seen.emplace(util::hash_bytes(bytes + entry.offset + commons::header_size, length), std::make_pair(entry, section));
+                }
+                
+            private:
+                //point sections that are complete in the file
+                const bool records_length(const section_entry& entry, std::size_t& length) const{
+                    if(entry.format == FORMAT::ColorPalette || entry.number_of_records == 0) return false;
+                    length = entry.number_of_records * commons::record_size(static_cast<FORMAT>(entry.format));
+                    return length && entry.offset + commons::header_size + length <= size;
+                }
+                
+                const uint8_t* bytes;
+                std::size_t size;
+                std::unordered_multimap<uint64_t, std::pair<section_entry, std::shared_ptr<ilda_section_base>>> seen;
+            };
+        };
+        
+        namespace write_functions{
+            namespace commons{
+                //32 byte big endian header. names are padded with 0, never read past the end of the string.
+                void encode_header(const ilda_section_base& section_base, uint8_t* dst){
+                    const std::size_t name_length = header_layout::name_length;
+                    std::memcpy(dst + header_layout::magic, "ILDA", 4);
+                    dst[4] = dst[5] = dst[6] = 0;
+                    dst[header_layout::format] = uint8_t(section_base.format);
+                    std::memset(dst + header_layout::name, 0, 2 * name_length);
+                    std::memcpy(dst + header_layout::name, section_base.name.data(), std::min(section_base.name.size(), name_length));
+                    std::memcpy(dst + header_layout::company_name, section_base.company_name.data(), std::min(section_base.company_name.size(), name_length));
+                    util::write_16b(dst + header_layout::number_of_records, section_base.number_of_records);
+                    util::write_16b(dst + header_layout::frame_number, section_base.frame_number);
+                    util::write_16b(dst + header_layout::total_frames, section_base.total_frames);
+                    dst[header_layout::projector_number] = section_base.projector_number;
+                    dst[header_layout::none] = section_base.none;
+                }
+                
+                void write_header(const ilda_section_base& section_base, std::ofstream& ofs){
+                    uint8_t header[load_functions::commons::header_size];
+                    encode_header(section_base, header);
+                    ofs.write((char*)header, load_functions::commons::header_size);
+                }
+            };
+            
+            //encode count records of section.data as big endian bytes into dst
+            template<FORMAT format> void type_write(const ilda_section<format>& section, uint8_t* dst, std::size_t count){
+                codec<format>::encode(section, dst, count);
+            }
+            
+            //exact encoded size of a section, header included
+            const std::size_t section_size(const ilda_section_base& section_base){
+                return load_functions::commons::header_size + section_base.number_of_records * load_functions::commons::record_size(section_base.format);
+            }
+            
+            std::size_t data_size(const ilda_section_base& section_base){
+                return visit(section_base, [](const auto& section) -> std::size_t { return section.data.size(); });
+            }
+            
+            const void* data_pointer(const ilda_section_base& section_base){
+                return visit(section_base, [](const auto& section) -> const void* { return section.data.data(); });
+            }
+            
+            //serializes header and records into dst, which must hold section_size() bytes.
+            //records missing from data (number_of_records > data.size()) are written as zero.
+            void encode_section(const ilda_section_base& section_base, uint8_t* dst){
+                commons::encode_header(section_base, dst);
+                dst += load_functions::commons::header_size;
+                const std::size_t record_size = load_functions::commons::record_size(section_base.format);
+                const std::size_t count = std::min<std::size_t>(section_base.number_of_records, data_size(section_base));
+                if(count < section_base.number_of_records){
+                    ofLogWarning("ofxIldaFile") << "section has " << count << " points for " << section_base.number_of_records << " records";
+                    std::memset(dst + count * record_size, 0, (section_base.number_of_records - count) * record_size);
+                }
+                visit(section_base, [&](const auto& section){ type_write(section, dst, count); });
+            }
+            
+            void write_sections(std::shared_ptr<ilda_section_base>& section_base, std::ofstream& ofs){
+                std::vector<uint8_t> buffer(section_size(*section_base));
+                encode_section(*section_base, buffer.data());
+                ofs.write((char*)buffer.data(), buffer.size());
+            }
+            
+            //sections are serialized back to back into one block buffer and flushed when the next one does not fit.
+            //a section larger than the block is serialized into its own exact size buffer.
+            struct buffered_writer{
+                buffered_writer(std::ostream& ofs, std::size_t block_size = 1 << 22) : ofs(ofs){
+                    buffer.resize(block_size);
+                }
+                ~buffered_writer(){ flush(); }
+                
+                void write(const ilda_section_base& section_base){
+                    const std::size_t size = section_size(section_base);
+                    if(used + size > buffer.size()) flush();
+                    if(size > buffer.size()){
+                        std::vector<uint8_t> large(size);
+                        encode_section(section_base, large.data());
+                        ofs.write((char*)large.data(), size);
+                        bytes_written += size;
+                        return;
+                    }
+                    encode_section(section_base, buffer.data() + used);
+                    used += size;
+                }
+                
+                void flush(){
+                    if(used){
+                        ofs.write((char*)buffer.data(), used);
+                        bytes_written += used;
+                        used = 0;
+                    }
+                }
+                
+                uint64_t get_bytes_written() const{ return bytes_written; }
+                
+            private:
+                std::ostream& ofs;
+                std::vector<uint8_t> buffer;
+                std::size_t used = 0;
+                uint64_t bytes_written = 0;
+            };
+            
+            //sizes the output file once and serializes every section straight into the mapping.
+            const bool write_mapped(const std::vector<std::shared_ptr<ilda_section_base>>& sections, const std::string& path){
+                std::size_t total = 0;
+                for(auto& e : sections) total += section_size(*e);
+                util::mapped_file mapped;
+                if(!mapped.create(path, total)) return false;
+                uint8_t* dst = mapped.data();
+                for(auto& e : sections){
+                    encode_section(*e, dst);
+                    dst += section_size(*e);
+                }
+                return true;
+            }
+        };
+        
+        namespace packed_functions{
+            //adapters between the tuple layout of ilda_section and packed_section. palettes have no points and return false.
+            template<FORMAT format> const bool to_packed(const ilda_section<format>& section, packed_section& packed){
+                packed.resize(section.data.size());
+                for(std::size_t i = 0 ; i < section.data.size() ; ++i){
+                    const auto& d = section.data[i];
+                    const ofVec3f pos(std::get<0>(d));
+                    packed.x[i] = pos.x;
+                    packed.y[i] = pos.y;
+                    if(format_traits<format>::dimensions == 3) packed.z[i] = pos.z;
+                    packed.status[i] = std::get<1>(d);
+                    packed.color[i] = util::get_color(std::get<2>(d));
+                }
+                return true;
+            }
+            
+            //native arrays -> tuple layout. z may be null.
+            template<FORMAT format> const bool from_arrays(const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, ilda_section<format>& section){
+                auto& data = section.data;
+                data.resize(count);
+                const bool is_3d = format_traits<format>::dimensions == 3 && z;
+                for(std::size_t i = 0 ; i < count ; ++i){
+                    auto& d = data[i];
+                    util::set_point(std::get<0>(d), x[i], y[i], is_3d ? z[i] : 0);
+                    std::get<1>(d) = status[i];
+                    util::set_color(std::get<2>(d), color[i]);
+                }
+                return true;
+            }
+            
+            template<FORMAT format> const bool from_packed(const packed_section& packed, ilda_section<format>& section){
+                return from_arrays(packed.x.data(), packed.y.data(), packed.is_3d() ? packed.z.data() : nullptr, packed.status.data(), packed.color.data(), packed.size(), section);
+            }
+            
+            template<> const bool to_packed(const ilda_section<FORMAT::ColorPalette>& section, packed_section& packed){ return false; }
+            template<> const bool from_arrays(const int16_t* x, const int16_t* y, const int16_t* z, const uint8_t* status, const uint32_t* color, std::size_t count, ilda_section<FORMAT::ColorPalette>& section){ return false; }
+            template<> const bool from_packed(const packed_section& packed, ilda_section<FORMAT::ColorPalette>& section){ return false; }
+            
+            //copies the header and points of any point section into packed. returns false for palettes.
+            const bool to_packed(const ilda_section_base& section_base, packed_section& packed){
+                static_cast<ilda_section_base&>(packed) = section_base;
+                if(!visit(section_base, [&](const auto& section){ return to_packed(section, packed); })){
+                    packed.clear();
+                    return false;
+                }
+                return true;
+            }
+            
+            template<FORMAT format>
+            std::shared_ptr<ilda_section_base> make_section(const packed_section& packed){
+                std::shared_ptr<ilda_section<format>> section(new ilda_section<format>());
+                static_cast<ilda_section_base&>(*section) = packed;
+                if(!from_packed(packed, *section)) return std::shared_ptr<ilda_section_base>();
+                return section;
+            }
+            
+            std::shared_ptr<ilda_section_base> from_packed(const packed_section& packed){
+                return dispatch(packed.format, [&](auto tag){ return make_section<decltype(tag)::value>(packed); });
+            }
+            
+            //big endian records <-> arrays, count records starting at packed index first
+            void decode(packed_section& packed, std::size_t first, const uint8_t* src, std::size_t count){
+                kernels::decode(packed.format, src, count, packed.x.data() + first, packed.y.data() + first, packed.is_3d() ? packed.z.data() + first : nullptr, packed.status.data() + first, packed.color.data() + first);
+            }
+            
+            void encode(const packed_section& packed, std::size_t first, uint8_t* dst, std::size_t count){
+                kernels::encode(packed.format, packed.x.data() + first, packed.y.data() + first, packed.is_3d() ? packed.z.data() + first : nullptr, packed.status.data() + first, packed.color.data() + first, count, dst);
+            }
+            
+            //indexed -> true color through the palette lookup table. true color sections are left untouched.
+            void resolve_palette(packed_section& packed, const ilda_palette& palette){
+                if(packed.format == FORMAT::Coordinates3D){
+                    packed.format = FORMAT::Coordinates3DwTrueColor;
+                }else if(packed.format == FORMAT::Coordinates2D){
+                    packed.format = FORMAT::Coordinates2DwTrueColor;
+                }else{
+                    return;
+                }
+                kernels::resolve_palette(palette.lut.data(), packed.color.data(), packed.size(), packed.color.data());
+            }
+            
+            //decode a section from mapped bytes directly into arrays, without going through the tuple layout.
+            const bool load_section(packed_section& packed, const uint8_t* src, std::size_t size){
+                if(size < load_functions::commons::header_size || !load_functions::commons::read_ilda(src)) return false;
+                const FORMAT format = (FORMAT)src[header_layout::format];
+                const std::size_t record_size = load_functions::commons::record_size(format);
+                if(record_size == 0 || format == FORMAT::ColorPalette) return false;
+                packed.format = format;
+                load_functions::commons::read_header(packed, src);
+                std::size_t count = packed.number_of_records;
+                if(load_functions::commons::header_size + count * record_size > size){
+                    count = (size - load_functions::commons::header_size) / record_size;
+                    packed.number_of_records = count;
+                }
+                packed.resize(count);
+                decode(packed, 0, src + load_functions::commons::header_size, count);
+                return true;
+            }
+            
+            const bool load_section(packed_section& packed, std::ifstream& ifs){
+                uint8_t header_buf[load_functions::commons::header_size];
+                ifs.read((char*)header_buf, load_functions::commons::header_size);
+                if(ifs.gcount() != load_functions::commons::header_size || !load_functions::commons::read_ilda(header_buf)) return false;
+                const FORMAT format = (FORMAT)header_buf[header_layout::format];
+                const std::size_t record_size = load_functions::commons::record_size(format);
+                if(record_size == 0 || format == FORMAT::ColorPalette) return false;
+                packed.format = format;
+                load_functions::commons::read_header(packed, header_buf);
+                packed.resize(packed.number_of_records);
+                
+                const std::size_t chunk_records = load_functions::commons::stream_chunk_size / record_size;
+                std::array<uint8_t, load_functions::commons::stream_chunk_size> chunk;
+                std::size_t loaded = 0;
+                while(loaded < packed.number_of_records){
+                    const std::size_t request = std::min<std::size_t>(packed.number_of_records - loaded, chunk_records);
+                    ifs.read((char*)chunk.data(), request * record_size);
+                    const std::size_t count = ifs.gcount() / record_size;
+                    decode(packed, loaded, chunk.data(), count);
+                    loaded += count;
+                    if(count < request){
+                        packed.number_of_records = loaded;
+                        packed.resize(loaded);
+                        break;
+                    }
+                }
+                return true;
+            }
+            
+            void write_section(const packed_section& packed, std::ofstream& ofs){
+                write_functions::commons::write_header(packed, ofs);
+                const std::size_t record_size = load_functions::commons::record_size(packed.format);
+                const std::size_t chunk_records = load_functions::commons::stream_chunk_size / record_size;
+                std::array<uint8_t, load_functions::commons::stream_chunk_size> chunk;
+                const std::size_t num = std::min<std::size_t>(packed.number_of_records, packed.size());
+                for(std::size_t i = 0 ; i < num ; i += chunk_records){
+                    const std::size_t count = std::min(chunk_records, num - i);
+                    encode(packed, i, chunk.data(), count);
+                    ofs.write((char*)chunk.data(), count * record_size);
+                }
+            }
+        };
+        
+        //native endian sidecar of a decoded file, written next to it as <path>.ildc. it holds the section index and every
+        //section as aligned arrays (color, x, y, z, status), so loading it is a copy without byte swapping or index walk.
+        //a cache is only used while its source file still has the size and modification time recorded in it and its
+        //table checksum matches.
+        namespace cache_functions{
+            const uint32_t version = 3;
+            const uint32_t byte_order = 0x01020304;
+            
+            //file_header, section_header * num_sections, section_entry * num_entries, then the data blocks, 8 byte aligned
+            struct file_header{
+                char magic[8];
+                uint32_t version;
+                uint32_t byte_order;
+                uint64_t source_size;
+                int64_t source_mtime;
+                uint64_t num_sections;
+                uint64_t num_entries;
+                uint64_t file_size;
+                //hash of the fields above and of both tables
+                uint64_t checksum;
+            };
+            
+            struct section_header{
+                uint64_t data_offset;
+                uint32_t size;
+                uint16_t number_of_records;
+                uint16_t frame_number;
+                uint16_t total_frames;
+                uint8_t format;
+                uint8_t projector_number;
+                uint8_t none;
+                uint8_t padding[3];
+                uint32_t reserved[2];
+                char name[8];
+                char company_name[8];
+            };
+            
+            std::string cache_path(const std::string& path){ return path + ".ildc"; }
+            
+            std::size_t align(std::size_t size){ return (size + 7) & ~std::size_t(7); }
+            
+            std::size_t block_size(FORMAT format, std::size_t size){
+                const std::size_t dimensions = dispatch(format, [](auto tag){ return std::size_t(format_traits<decltype(tag)::value>::dimensions); });
+                return align(size * (sizeof(uint32_t) + dimensions * sizeof(int16_t) + (dimensions ? sizeof(uint8_t) : 0)));
+            }
+            
+            uint64_t checksum(const uint8_t* bytes, std::size_t tables_size){
+                return util::hash_bytes(bytes, offsetof(file_header, checksum)) * 31 + util::hash_bytes(bytes + sizeof(file_header), tables_size);
+            }
+            
+            std::size_t point_count(const ilda_section_base& section_base){
+                if(section_base.format == FORMAT::ColorPalette) return std::min<std::size_t>(section_base.number_of_records, 256);
+                return write_functions::data_size(section_base);
+            }
+            
+            //sections from first on. written to a temporary file and renamed, so a crash never leaves a half written cache.
+            //source_size and source_mtime are the stamp of path taken before the sections were loaded, nothing is written
+            //when path has changed since then.
+            const bool write(const std::string& path, const std::vector<std::shared_ptr<ilda_section_base>>& sections, std::size_t first, const std::vector<section_entry>& index, uint64_t source_size, int64_t source_mtime){
+                uint64_t current_size;
+                int64_t current_mtime;
+                if(!util::file_stamp(path, current_size, current_mtime)) return false;
+                if(current_size != source_size || current_mtime != source_mtime){
+                    ofLogNotice("ofxIldaFile") << "file changed while loading, skip cache : " << path;
+                    return false;
+                }
+                std::vector<const ilda_section_base*> cached;
+                for(std::size_t i = first ; i < sections.size() ; ++i) if(sections[i]) cached.push_back(sections[i].get());
+                
+                const std::size_t tables_size = align(cached.size() * sizeof(section_header) + index.size() * sizeof(section_entry));
+                std::vector<section_header> headers(cached.size());
+                std::size_t file_size = sizeof(file_header) + tables_size;
+                for(std::size_t i = 0 ; i < cached.size() ; ++i){
+                    const ilda_section_base& section = *cached[i];
+                    section_header& h = headers[i];
+                    std::memset(&h, 0, sizeof(h));
+                    h.size = point_count(section);
+                    h.number_of_records = section.number_of_records;
+                    h.frame_number = section.frame_number;
+                    h.total_frames = section.total_frames;
+                    h.format = section.format;
+                    h.projector_number = section.projector_number;
+                    h.none = section.none;
+                    std::memcpy(h.name, section.name.data(), std::min<std::size_t>(section.name.size(), 8));
+                    std::memcpy(h.company_name, section.company_name.data(), std::min<std::size_t>(section.company_name.size(), 8));
+                    h.data_offset = file_size;
+                    file_size += block_size(section.format, h.size);
+                }
+                
+                const std::string tmp_path = cache_path(path) + ".tmp";
+                util::mapped_file out;
+                if(!out.create(tmp_path, file_size)) return false;
+                uint8_t* bytes = out.data();
+                std::memset(bytes, 0, sizeof(file_header) + tables_size);
+                file_header& header = *reinterpret_cast<file_header*>(bytes);
+                std::memcpy(header.magic, "OFXILDAC", 8);
+                header.version = version;
+                header.byte_order = byte_order;
+                header.source_size = source_size;
+                header.source_mtime = source_mtime;
+                header.num_sections = cached.size();
+                header.num_entries = index.size();
+                header.file_size = file_size;
+                uint8_t* tables = bytes + sizeof(file_header);
+                if(!headers.empty()) std::memcpy(tables, headers.data(), headers.size() * sizeof(section_header));
+                //field by field, the padding of section_entry stays zero and the checksum reproducible
+                section_entry* entries = reinterpret_cast<section_entry*>(tables + headers.size() * sizeof(section_header));
+                for(std::size_t i = 0 ; i < index.size() ; ++i){
+                    entries[i].offset = index[i].offset;
+                    entries[i].palette_section = index[i].palette_section;
+                    entries[i].number_of_records = index[i].number_of_records;
+                    entries[i].format = index[i].format;
+                }
+                header.checksum = checksum(bytes, tables_size);
+                
+                packed_section packed;
+                for(std::size_t i = 0 ; i < cached.size() ; ++i){
+                    const section_header& h = headers[i];
+                    uint8_t* dst = bytes + h.data_offset;
+                    if(h.format == FORMAT::ColorPalette){
+                        const auto& palette = static_cast<const ilda_section<FORMAT::ColorPalette>&>(*cached[i]);
+                        for(std::size_t k = 0 ; k < h.size ; ++k) reinterpret_cast<uint32_t*>(dst)[k] = util::get_color(palette.data[k]);
+                    }else{
+                        packed_functions::to_packed(*cached[i], packed);
+                        std::memcpy(dst, packed.color.data(), h.size * sizeof(uint32_t));
+                        dst += h.size * sizeof(uint32_t);
+                        std::memcpy(dst, packed.x.data(), h.size * sizeof(int16_t));
+                        dst += h.size * sizeof(int16_t);
+                        std::memcpy(dst, packed.y.data(), h.size * sizeof(int16_t));
+                        dst += h.size * sizeof(int16_t);
+                        if(packed.is_3d()){
+                            std::memcpy(dst, packed.z.data(), h.size * sizeof(int16_t));
+                            dst += h.size * sizeof(int16_t);
+                        }
+                        std::memcpy(dst, packed.status.data(), h.size);
+                    }
+                }
+                out.close();
+#ifdef TARGET_WIN32
+                //rename does not replace an existing file on windows
+                std::remove(cache_path(path).c_str());
+#endif
+                if(std::rename(tmp_path.c_str(), cache_path(path).c_str()) != 0){
+                    std::remove(tmp_path.c_str());
+                    return false;
+                }
+                return true;
+            }
+            
+            template<FORMAT format>
+            std::shared_ptr<ilda_section_base> load_block(const uint8_t* block, std::size_t size){
+                std::shared_ptr<ilda_section<format>> section(new ilda_section<format>());
+                const uint32_t* color = reinterpret_cast<const uint32_t*>(block);
+                const int16_t* x = reinterpret_cast<const int16_t*>(block + size * sizeof(uint32_t));
+                const int16_t* y = x + size;
+                const int16_t* z = format_traits<format>::dimensions == 3 ? y + size : nullptr;
+                const uint8_t* status = reinterpret_cast<const uint8_t*>(y + size * (format_traits<format>::dimensions - 1));
+                packed_functions::from_arrays(x, y, z, status, color, size, *section);
+                return section;
+            }
+            
+            template<> std::shared_ptr<ilda_section_base> load_block<FORMAT::ColorPalette>(const uint8_t* block, std::size_t size){
+                return std::shared_ptr<ilda_section_base>();
+            }
+            
+            //appends the cached sections and replaces index. false when there is no cache or it does not match path,
+            //then sections and index are left untouched.
+            const bool load(const std::string& path, std::vector<std::shared_ptr<ilda_section_base>>& sections, std::vector<section_entry>& index){
+                uint64_t source_size;
+                int64_t source_mtime;
+                if(!util::file_stamp(path, source_size, source_mtime)) return false;
+                util::mapped_file mapped;
+                if(!mapped.open(cache_path(path)) || mapped.size() < sizeof(file_header)) return false;
+                const uint8_t* bytes = mapped.data();
+                const file_header& header = *reinterpret_cast<const file_header*>(bytes);
+                if(std::memcmp(header.magic, "OFXILDAC", 8) != 0 || header.version != version || header.byte_order != byte_order) return false;
+                if(header.source_size != source_size || header.source_mtime != source_mtime || header.file_size != mapped.size()) return false;
+                if(header.num_sections > mapped.size() / sizeof(section_header) || header.num_entries > mapped.size() / sizeof(section_entry)) return false;
+                const std::size_t tables_size = align(header.num_sections * sizeof(section_header) + header.num_entries * sizeof(section_entry));
+                if(sizeof(file_header) + tables_size > mapped.size() || header.checksum != checksum(bytes, tables_size)){
+                    ofLogWarning("ofxIldaFile") << "broken cache : " << cache_path(path);
+                    return false;
+                }
+                
+                const section_header* headers = reinterpret_cast<const section_header*>(bytes + sizeof(file_header));
+                std::vector<std::shared_ptr<ilda_section_base>> loaded(header.num_sections);
+                for(std::size_t i = 0 ; i < loaded.size() ; ++i){
+                    const section_header& h = headers[i];
+                    const FORMAT format = (FORMAT)h.format;
+                    if(load_functions::commons::record_size(format) == 0 || h.data_offset + block_size(format, h.size) > mapped.size()) return false;
+                    if(format == FORMAT::ColorPalette){
+                        if(h.size > 256) return false;
+                        std::shared_ptr<ilda_section<FORMAT::ColorPalette>> palette(new ilda_section<FORMAT::ColorPalette>());
+                        for(std::size_t k = 0 ; k < h.size ; ++k) util::set_color(palette -> data[k], reinterpret_cast<const uint32_t*>(bytes + h.data_offset)[k]);
+                        loaded[i] = palette;
+                    }else{
+                        loaded[i] = dispatch(format, [&](auto tag){ return load_block<decltype(tag)::value>(bytes + h.data_offset, h.size); });
+                        if(!loaded[i]) return false;
+                    }
+                    ilda_section_base& section = *loaded[i];
+                    section.format = format;
+                    section.name = std::string(h.name, std::find(h.name, h.name + 8, '\0'));
+                    section.company_name = std::string(h.company_name, std::find(h.company_name, h.company_name + 8, '\0'));
+                    section.number_of_records = h.number_of_records;
+                    section.frame_number = h.frame_number;
+                    section.total_frames = h.total_frames;
+                    section.projector_number = h.projector_number;
+                    section.none = h.none;
+                }
+                const section_entry* entries = reinterpret_cast<const section_entry*>(bytes + sizeof(file_header) + header.num_sections * sizeof(section_header));
+                index.assign(entries, entries + header.num_entries);
+                sections.insert(sections.end(), loaded.begin(), loaded.end());
+                return true;
+            }
+        };
+        
+        namespace preview_functions{
+            //preview geometry of a section in record coordinates. vertices are the unblanked points with their colors,
+            //indices join consecutive unblanked points into OF_PRIMITIVE_LINES segments. needs no gl context.
+            template<FORMAT format>
+            void build_mesh(const ilda_section<format>& section, ofMesh& mesh){
+                mesh.clear();
+                mesh.setMode(OF_PRIMITIVE_LINES);
+                const std::size_t size = section.data.size();
+                mesh.getVertices().reserve(size);
+                mesh.getColors().reserve(size);
+                mesh.getIndices().reserve(2 * size);
+                bool connected = false;
+                for(std::size_t i = 0 ; i < size ; ++i){
+                    const auto& d = section.data[i];
+                    if(std::get<1>(d) & (1 << 6)){
+                        connected = false;
+                        continue;
+                    }
+                    const ofIndexType vertex = mesh.getNumVertices();
+                    mesh.addVertex(ofVec3f(std::get<0>(d)));
+                    mesh.addColor(section.color(i));
+                    if(connected){
+                        mesh.addIndex(vertex - 1);
+                        mesh.addIndex(vertex);
+                    }
+                    connected = true;
+                }
+            }
+            
+            void build_mesh(const ilda_section<FORMAT::ColorPalette>& section, ofMesh& mesh){
+                mesh.clear();
+                mesh.setMode(OF_PRIMITIVE_LINES);
+            }
+            
+            const bool build_mesh(const ilda_section_base& section_base, ofMesh& mesh){
+                return visit(section_base, [&](const auto& section){
+                    build_mesh(section, mesh);
+                    return true;
+                });
+            }
+        };
+        
+        //one cached preview mesh per section, drawn with one call for the lines and one for the points.
+        //a mesh is rebuilt when its section was replaced or its data was reallocated or resized,
+        //in place edits of point values need invalidate(). use from the drawing thread only.
+        struct preview_renderer{
+            const ofMesh& get_mesh(const std::shared_ptr<ilda_section_base>& section){
+                const std::size_t size = write_functions::data_size(*section);
+                const void* data = write_functions::data_pointer(*section);
+                auto found = cache.find(section.get());
+                if(found != cache.end()){
+                    entry& e = found -> second;
+                    if(e.section.lock() == section && e.data == data && e.size == size && e.number_of_records == section -> number_of_records){
+                        return e.mesh;
+                    }
+                }else{
+                    if(cache.size() >= prune_size) prune();
+                    found = cache.emplace(section.get(), entry()).first;
+                }
+                entry& e = found -> second;
+                e.section = section;
+                e.data = data;
+                e.size = size;
+                e.number_of_records = section -> number_of_records;
+                if(!preview_functions::build_mesh(*section, e.mesh)) e.mesh.clear();
+                ++builds;
+                return e.mesh;
+            }
+            
+            //scale is pixels per record unit
+            void draw(const std::shared_ptr<ilda_section_base>& section, float scale, float point_size = 3.0){
+                if(!section) return;
+                const ofMesh& mesh = get_mesh(section);
+                if(mesh.getNumVertices() == 0) return;
+                ofPushMatrix();
+                ofScale(scale, scale, scale);
+                mesh.draw();
+                //gles has no glPointSize, points are drawn at the size of the default shader there
+#ifndef TARGET_OPENGLES
+                glPointSize(point_size);
+#endif
+                mesh.drawVertices();
+#ifndef TARGET_OPENGLES
+                glPointSize(1.0);
+#endif
+                ofPopMatrix();
+            }
+            
+            void invalidate(const ilda_section_base* section){ cache.erase(section); }
+            void clear(){ cache.clear(); }
+            
+            std::size_t get_num_meshes() const{ return cache.size(); }
+            uint64_t get_builds() const{ return builds; }
+            
+        private:
+            struct entry{
+                std::weak_ptr<ilda_section_base> section;
+                const void* data = nullptr;
+                std::size_t size = 0;
+                uint16_t number_of_records = 0;
+                ofMesh mesh;
+            };
+            
+            //drops the meshes of sections that no longer exist
+            void prune(){
+                for(auto it = cache.begin() ; it != cache.end() ;){
+                    if(it -> second.section.expired()) it = cache.erase(it);
+                    else ++it;
+                }
+                prune_size = std::max<std::size_t>(64, cache.size() * 2);
+            }
+            
+            std::unordered_map<const ilda_section_base*, entry> cache;
+            std::size_t prune_size = 64;
+            uint64_t builds = 0;
+        };
+        
+        //galvo path optimizer. a frame is split into lit segments (runs of unblanked points) and the blanked points between
+        //them are dropped, then the segments are reordered nearest neighbour first, reversed when that shortens the jump,
+        //and joined by evenly spaced blanked travel points. dwell points are added at corners and around jumps,
+        //more for sharper corners and longer jumps.
+        namespace optimize_functions{
+            //distances are in record units
+            struct optimize_settings{
+                //max distance between two blanked travel points
+                float blank_step = 2048;
+                //blanked points held at both ends of a jump, from min for a zero length jump to max for a full scale one
+                std::size_t min_jump_dwell = 1;
+                std::size_t max_jump_dwell = 6;
+                //extra lit points at the first and last point of each segment
+                std::size_t anchor_points = 1;
+                //a corner turning more than corner_angle degrees repeats its point, max_corner_dwell times for a full turn back
+                float corner_angle = 45;
+                std::size_t max_corner_dwell = 4;
+                bool reorder = true;
+                bool allow_reverse = true;
+            };
+            
+            struct optimize_result{
+                std::size_t points_before = 0;
+                std::size_t points_after = 0;
+                std::size_t segments = 0;
+                //summed length of the jumps between segments
+                double travel_before = 0;
+                double travel_after = 0;
+                
+                optimize_result& operator+=(const optimize_result& r){
+                    points_before += r.points_before;
+                    points_after += r.points_after;
+                    segments += r.segments;
+                    travel_before += r.travel_before;
+                    travel_after += r.travel_after;
+                    return *this;
+                }
+            };
+            
+            template<typename record_type> const bool is_blank(const record_type& d){ return std::get<1>(d) & (1 << 6); }
+            
+            //same position and color, repeats of a point are dwell
+            template<typename record_type> const bool is_repeat(const record_type& a, const record_type& b){
+                return std::get<0>(a) == std::get<0>(b) && std::get<2>(a) == std::get<2>(b);
+            }
+            
+            template<typename record_type> float distance(const record_type& a, const record_type& b){
+                return ofVec3f(std::get<0>(a)).distance(ofVec3f(std::get<0>(b)));
+            }
+            
+            //status bit 6 is blanking, bit 7 marks the last point of the frame
+            template<typename record_type> record_type blanked(record_type d){
+                std::get<1>(d) = (std::get<1>(d) | (1 << 6)) & ~(1 << 7);
+                return d;
+            }
+            
+            template<typename record_type> record_type lit(record_type d){
+                std::get<1>(d) &= ~((1 << 6) | (1 << 7));
+                return d;
+            }
+            
+            template<typename record_type>
+            std::size_t corner_dwell(const record_type& prev, const record_type& point, const record_type& next, const optimize_settings& settings){
+                const ofVec3f a = ofVec3f(std::get<0>(point)) - ofVec3f(std::get<0>(prev));
+                const ofVec3f b = ofVec3f(std::get<0>(next)) - ofVec3f(std::get<0>(point));
+                const float length = a.length() * b.length();
+                if(length <= 0 || settings.corner_angle >= 180) return 0;
+                const float cos_angle = std::max(-1.0f, std::min(1.0f, (a.x * b.x + a.y * b.y + a.z * b.z) / length));
+                const float angle = std::acos(cos_angle) * 180.0f / PI;
+                if(angle <= settings.corner_angle) return 0;
+                return std::ceil(settings.max_corner_dwell * (angle - settings.corner_angle) / (180.0f - settings.corner_angle));
+            }
+            
+            //blanked points from the end of one segment to the start of the next, dwelling at both ends
+            template<typename record_type>
+            void jump(std::vector<record_type>& out, const record_type& from, const record_type& to, float length, const optimize_settings& settings){
+                const float scale = std::min(length / 65535.0f, 1.0f);
+                const std::size_t dwell = settings.min_jump_dwell + std::lround((settings.max_jump_dwell - float(settings.min_jump_dwell)) * scale);
+                const std::size_t steps = settings.blank_step > 0 ? std::ceil(length / settings.blank_step) : 1;
+                for(std::size_t i = 0 ; i < dwell ; ++i) out.push_back(blanked(from));
+                for(std::size_t i = 1 ; i < steps ; ++i){
+                    record_type d = blanked(to);
+                    std::get<0>(d) = std::get<0>(from) + (std::get<0>(to) - std::get<0>(from)) * (float(i) / steps);
+                    out.push_back(d);
+                }
+                for(std::size_t i = 0 ; i < dwell ; ++i) out.push_back(blanked(to));
+            }
+            
+            //frames without lit points or whose result would not fit in number_of_records are left as they are
+            template<FORMAT format>
+            optimize_result optimize(ilda_section<format>& section, const optimize_settings& settings){
+                typedef typename decltype(section.data)::value_type record_type;
+                const std::vector<record_type>& data = section.data;
+                optimize_result result;
+                result.points_before = result.points_after = data.size();
+                
+                //first and last index of each lit run
+                std::vector<std::pair<std::size_t, std::size_t>> segments;
+                for(std::size_t i = 0 ; i < data.size() ; ++i){
+                    if(is_blank(data[i])) continue;
+                    if(!segments.empty() && segments.back().second + 1 == i) segments.back().second = i;
+                    else segments.emplace_back(i, i);
+                }
+                result.segments = segments.size();
+                if(segments.empty()) return result;
+                for(std::size_t i = 1 ; i < segments.size() ; ++i) result.travel_before += distance(data[segments[i - 1].second], data[segments[i].first]);
+                
+                //scan order, segment index and whether it runs backwards. the first segment stays first.
+                std::vector<std::pair<std::size_t, bool>> order;
+                order.reserve(segments.size());
+                order.emplace_back(0, false);
+                if(settings.reorder){
+                    std::vector<bool> used(segments.size(), false);
+                    used[0] = true;
+                    for(std::size_t n = 1 ; n < segments.size() ; ++n){
+                        const auto& current = segments[order.back().first];
+                        const record_type& from = data[order.back().second ? current.first : current.second];
+                        float best = std::numeric_limits<float>::max();
+                        std::pair<std::size_t, bool> next(0, false);
+                        for(std::size_t j = 1 ; j < segments.size() ; ++j){
+                            if(used[j]) continue;
+                            const float forward = distance(from, data[segments[j].first]);
+                            if(forward < best){
+                                best = forward;
+                                next = std::make_pair(j, false);
+                            }
+                            if(!settings.allow_reverse) continue;
+                            const float backward = distance(from, data[segments[j].second]);
+                            if(backward < best){
+                                best = backward;
+                                next = std::make_pair(j, true);
+                            }
+                        }
+                        used[next.first] = true;
+                        order.push_back(next);
+                    }
+                }else{
+                    for(std::size_t i = 1 ; i < segments.size() ; ++i) order.emplace_back(i, false);
+                }
+                
+                std::vector<record_type> out;
+                out.reserve(data.size() + segments.size() * (2 * settings.max_jump_dwell + 2 * settings.anchor_points + 2));
+                std::vector<std::size_t> points;
+                for(std::size_t n = 0 ; n < order.size() ; ++n){
+                    const auto& segment = segments[order[n].first];
+                    const bool reversed = order[n].second;
+                    const std::size_t first = reversed ? segment.second : segment.first;
+                    //existing dwell is dropped and rebuilt, so it does not pile up when a frame is optimized again
+                    points.clear();
+                    for(std::size_t k = 0 ; k <= segment.second - segment.first ; ++k){
+                        const std::size_t i = reversed ? first - k : first + k;
+                        if(points.empty() || !is_repeat(data[points.back()], data[i])) points.push_back(i);
+                    }
+                    if(n == 0){
+                        for(std::size_t i = 0 ; i < settings.min_jump_dwell ; ++i) out.push_back(blanked(data[first]));
+                    }else{
+                        const record_type from = out.back();
+                        const float travel = distance(from, data[first]);
+                        result.travel_after += travel;
+                        if(travel > 0) jump(out, from, data[first], travel, settings);
+                    }
+                    for(std::size_t k = 0 ; k < points.size() ; ++k){
+                        const record_type& point = data[points[k]];
+                        std::size_t repeat = 1;
+                        if(k == 0 || k + 1 == points.size()) repeat += settings.anchor_points;
+                        else repeat += corner_dwell(data[points[k - 1]], point, data[points[k + 1]], settings);
+                        for(std::size_t r = 0 ; r < repeat ; ++r) out.push_back(lit(point));
+                    }
+                }
+                //ends blanked so the move to the next frame is not drawn
+                const record_type last = out.back();
+                for(std::size_t i = 0 ; i < settings.min_jump_dwell ; ++i) out.push_back(blanked(last));
+                if(std::get<1>(data.back()) & (1 << 7)) std::get<1>(out.back()) |= (1 << 7);
+                
+                if(out.size() > std::numeric_limits<uint16_t>::max()){
+                    ofLogWarning("ofxIldaFile") << "optimized frame has too many points, keep original : " << out.size();
+                    return result;
+                }
+                result.points_after = out.size();
+                section.number_of_records = out.size();
+                section.data.swap(out);
+                return result;
+            }
+            
+            optimize_result optimize(ilda_section<FORMAT::ColorPalette>& section, const optimize_settings& settings){
+                return optimize_result();
+            }
+            
+            optimize_result optimize(ilda_section_base& section_base, const optimize_settings& settings){
+                return visit(section_base, [&](auto& section){ return optimize(section, settings); });
+            }
+            
+            //frames are independent and optimized on the pool, the result is summed over all sections
+            optimize_result optimize(std::vector<std::shared_ptr<ilda_section_base>>& sections, const optimize_settings& settings, util::worker_pool& pool){
+                std::vector<optimize_result> results(sections.size());
+                pool.parallel_for(sections.size(), [&](std::size_t i, std::size_t worker){
+                    if(sections[i]) results[i] = optimize(*sections[i], settings);
+                });
+                optimize_result total;
+                for(auto& r : results) total += r;
+                return total;
+            }
+        };
+        
+        //resampling of a frame to a point count, usually points per second / frames per second of the projector.
+        //the first and last point, points where blanking switches, corners and repeated points (dwell) are always kept.
+        //the remaining points are spread evenly along the path between them, positions and colors are interpolated.
+        namespace resample_functions{
+            struct resample_settings{
+                //a lit point turning more than corner_angle degrees is kept
+                float corner_angle = 30;
+                //false keeps frames that already have fewer points than the target as they are
+                bool allow_upsample = true;
+            };
+            
+            std::size_t points_for(std::size_t points_per_second, float frames_per_second){
+                return frames_per_second > 0 ? std::size_t(points_per_second / frames_per_second) : 0;
+            }
+            
+            struct resample_result{
+                std::size_t sections = 0;
+                //resampled sections still above the target, see resampler::resample
+                std::size_t over_budget = 0;
+            };
+            
+            //scratch buffers, reused between frames of one worker
+            struct resampler{
+                //resamples packed to target points, at most 65535. when more points are worth keeping than the target allows,
+                //dwell repeats go first, then corners from the shallowest on. blanking edges and the end points always stay,
+                //so a frame with more of those than target points ends up above the target.
+                const bool resample(packed_section& packed, std::size_t target, const resample_settings& settings = resample_settings()){
+                    const std::size_t size = packed.size();
+                    target = std::min<std::size_t>(target, std::numeric_limits<uint16_t>::max());
+                    if(size < 2 || target == size || (target > size && !settings.allow_upsample)) return false;
+                    const bool is_3d = packed.is_3d();
+                    
+                    length.resize(size - 1);
+                    kernels::segment_lengths(packed.x.data(), packed.y.data(), is_3d ? packed.z.data() : nullptr, size, length.data());
+                    
+                    //priority of a kept point : dwell repeats -2, corners minus the cosine of their turn, blanking edges and end points keep_always
+                    const float keep_always = 2;
+                    const float cos_corner = std::cos(settings.corner_angle * PI / 180.0f);
+                    keep.clear();
+                    priority.clear();
+                    keep.push_back(0);
+                    priority.push_back(keep_always);
+                    for(std::size_t i = 1 ; i + 1 < size ; ++i){
+                        const bool blank_in = packed.is_blank(i);
+                        const bool blank_out = packed.is_blank(i + 1);
+                        if(blank_in != blank_out){
+                            keep.push_back(i);
+                            priority.push_back(keep_always);
+                        }else if(length[i - 1] == 0 || length[i] == 0){
+                            keep.push_back(i);
+                            priority.push_back(-2);
+                        }else if(!blank_in){
+                            const float ax = float(packed.x[i]) - packed.x[i - 1], ay = float(packed.y[i]) - packed.y[i - 1];
+                            const float bx = float(packed.x[i + 1]) - packed.x[i], by = float(packed.y[i + 1]) - packed.y[i];
+                            float dot = ax * bx + ay * by;
+                            if(is_3d) dot += (float(packed.z[i]) - packed.z[i - 1]) * (float(packed.z[i + 1]) - packed.z[i]);
+                            if(dot < cos_corner * length[i - 1] * length[i]){
+                                keep.push_back(i);
+                                priority.push_back(-dot / (length[i - 1] * length[i]));
+                            }
+                        }
+                    }
+                    keep.push_back(size - 1);
+                    priority.push_back(keep_always);
+                    
+                    if(keep.size() > target){
+                        order.clear();
+                        for(std::size_t k = 0 ; k < keep.size() ; ++k) if(priority[k] < keep_always) order.push_back(k);
+                        const std::size_t drop = std::min(keep.size() - target, order.size());
+                        std::partial_sort(order.begin(), order.begin() + drop, order.end(), [&](std::size_t a, std::size_t b){
+                            return priority[a] < priority[b] || (priority[a] == priority[b] && a < b);
+                        });
+                        for(std::size_t d = 0 ; d < drop ; ++d) keep[order[d]] = size;
+                        keep.erase(std::remove(keep.begin(), keep.end(), size), keep.end());
+                    }
+                    
+                    //points between two kept points, shared out by path length with the largest remainders rounded up
+                    const std::size_t spans = keep.size() - 1;
+                    const std::size_t extra = target > keep.size() ? target - keep.size() : 0;
+                    cumulative.resize(size);
+                    cumulative[0] = 0;
+                    for(std::size_t i = 1 ; i < size ; ++i) cumulative[i] = cumulative[i - 1] + length[i - 1];
+                    const double total = cumulative[size - 1];
+                    span_points.assign(spans, 0);
+                    if(total > 0 && extra > 0){
+                        std::vector<std::pair<double, std::size_t>> remainders(spans);
+                        std::size_t given = 0;
+                        for(std::size_t s = 0 ; s < spans ; ++s){
+                            const double share = extra * (cumulative[keep[s + 1]] - cumulative[keep[s]]) / total;
+                            span_points[s] = share;
+                            given += span_points[s];
+                            remainders[s] = std::make_pair(share - span_points[s], s);
+                        }
+                        std::sort(remainders.begin(), remainders.end(), [](const std::pair<double, std::size_t>& a, const std::pair<double, std::size_t>& b){ return a.first > b.first; });
+                        for(std::size_t r = 0 ; given < extra ; ++r, ++given) ++span_points[remainders[r % spans].second];
+                    }
+                    
+                    //source position of every output point as (segment, t), then one interpolation pass
+                    index.clear();
+                    t.clear();
+                    status.clear();
+                    auto add_kept = [&](std::size_t i){
+                        index.push_back(std::min<std::size_t>(i, size - 2));
+                        t.push_back(i == size - 1 ? 1.0f : 0.0f);
+                        status.push_back(packed.status[i]);
+                    };
+                    for(std::size_t s = 0 ; s < spans ; ++s){
+                        const std::size_t a = keep[s];
+                        const std::size_t b = keep[s + 1];
+                        add_kept(a);
+                        const std::size_t m = span_points[s];
+                        std::size_t j = a;
+                        for(std::size_t k = 1 ; k <= m ; ++k){
+                            const double position = cumulative[a] + (cumulative[b] - cumulative[a]) * k / (m + 1);
+                            while(j + 1 < b && cumulative[j + 1] <= position) ++j;
+                            index.push_back(j);
+                            t.push_back(length[j] > 0 ? float((position - cumulative[j]) / length[j]) : 0.0f);
+                            status.push_back(packed.status[j + 1] & ~(1 << 7));
+                        }
+                    }
+                    add_kept(size - 1);
+                    
+                    const std::size_t count = index.size();
+                    out.format = packed.format;
+                    out.resize(count);
+                    const bool blend_color = packed.format == FORMAT::Coordinates3DwTrueColor || packed.format == FORMAT::Coordinates2DwTrueColor;
+                    kernels::interpolate(packed.x.data(), packed.y.data(), is_3d ? packed.z.data() : nullptr, packed.color.data(), blend_color, index.data(), t.data(), count, out.x.data(), out.y.data(), is_3d ? out.z.data() : nullptr, out.color.data());
+                    std::swap(packed.x, out.x);
+                    std::swap(packed.y, out.y);
+                    std::swap(packed.z, out.z);
+                    std::swap(packed.color, out.color);
+                    std::swap(packed.status, status);
+                    packed.number_of_records = count;
+                    return true;
+                }
+                
+                //any point section, through the packed layout. palettes are left as they are.
+                const bool resample(ilda_section_base& section_base, std::size_t target, const resample_settings& settings = resample_settings()){
+                    if(!packed_functions::to_packed(section_base, packed) || !resample(packed, target, settings)) return false;
+                    section_base.number_of_records = packed.number_of_records;
+                    return visit(section_base, [&](auto& section){ return packed_functions::from_packed(packed, section); });
+                }
+                
+            private:
+                std::vector<float> length;
+                std::vector<double> cumulative;
+                std::vector<std::size_t> keep;
+                std::vector<float> priority;
+                std::vector<std::size_t> order;
+                std::vector<std::size_t> span_points;
+                std::vector<uint32_t> index;
+                std::vector<float> t;
+                std::vector<uint8_t> status;
+                packed_section packed;
+                packed_section out;
+            };
+            
+            //every section on the pool, one resampler per worker
+            resample_result resample(std::vector<std::shared_ptr<ilda_section_base>>& sections, std::size_t target, const resample_settings& settings, util::worker_pool& pool){
+                std::vector<resampler> resamplers(pool.size());
+                std::atomic<std::size_t> count{0};
+                std::atomic<std::size_t> over_budget{0};
+                pool.parallel_for(sections.size(), [&](std::size_t i, std::size_t worker){
+                    if(!sections[i] || !resamplers[worker].resample(*sections[i], target, settings)) return;
+                    ++count;
+                    if(sections[i] -> number_of_records > target) ++over_budget;
+                });
+                resample_result result;
+                result.sections = count;
+                result.over_budget = over_budget;
+                return result;
+            }
+        };
+        
+        //counters and timings of load / write calls, accumulated until reset(). loader threads update it, so every field is atomic.
+        //with OFX_ILDA_NO_STATS nothing is recorded and every value stays 0.
+        struct ilda_stats{
+            enum STAGE{
+                Open = 0,
+                Discovery = 1,
+                Decode = 2,
+                Write = 3,
+                Flush = 4,
+            };
+            static const std::size_t num_stages = 5;
+            //indexed by format number
+            static const std::size_t num_formats = 6;
+            
+            struct snapshot{
+                std::array<uint64_t, num_stages> stage_nanos;
+                //summed over worker threads, can exceed the Decode stage of a parallel load
+                std::array<uint64_t, num_formats> decode_nanos;
+                std::array<uint64_t, num_formats> decoded_sections;
+                uint64_t bytes_read;
+                uint64_t bytes_written;
+                uint64_t sections;
+                uint64_t points;
+                //section objects plus point buffers the loaded sections need, derived from the sections and not
+                //a count of heap calls. example_benchmark measures real allocations with a replaced operator new.
+                uint64_t estimated_allocations;
+                uint64_t malformed_sections;
+                uint64_t skipped_sections;
+                
+                double seconds(STAGE stage) const{ return stage_nanos[stage] * 1e-9; }
+            };
+            
+            //called on the thread that finished the stage. set it before starting a load.
+            typedef std::function<void(STAGE, const snapshot&)> callback_type;
+            
+            static uint64_t now(){
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+            
+            void set_callback(callback_type callback){ stage_callback = callback; }
+            
+            void add_stage(STAGE stage, uint64_t nanos){
+                stage_nanos[stage] += nanos;
+                if(stage_callback) stage_callback(stage, get());
+            }
+            
+            //one decoded section. section is null when decoding failed.
+            void count_section(const section_entry& entry, const ilda_section_base* section, uint64_t nanos){
+                const std::size_t format = std::min<std::size_t>(entry.format, num_formats - 1);
+                decode_nanos[format] += nanos;
+                ++decoded_sections[format];
+                if(!section){
+                    ++malformed_sections;
+                    return;
+                }
+                bytes_read += load_functions::commons::header_size + section -> number_of_records * load_functions::commons::record_size(section -> format);
+                count_loaded(*section);
+                if(section -> number_of_records < entry.number_of_records) ++malformed_sections;
+            }
+            
+            //one section that was loaded without decoding ilda records, e.g. from the sidecar cache
+            void count_loaded(const ilda_section_base& section){
+                ++sections;
+                if(section.format != FORMAT::ColorPalette) points += section.number_of_records;
+                estimated_allocations += (section.format == FORMAT::ColorPalette || section.number_of_records == 0) ? 1 : 2;
+            }
+            
+            void count_read(uint64_t bytes){ bytes_read += bytes; }
+            void count_skipped(uint64_t count){ skipped_sections += count; }
+            void count_written(uint64_t bytes){ bytes_written += bytes; }
+            
+            snapshot get() const{
+                snapshot s;
+                for(std::size_t i = 0 ; i < num_stages ; ++i) s.stage_nanos[i] = stage_nanos[i];
+                for(std::size_t i = 0 ; i < num_formats ; ++i){
+                    s.decode_nanos[i] = decode_nanos[i];
+                    s.decoded_sections[i] = decoded_sections[i];
+                }
+                s.bytes_read = bytes_read;
+                s.bytes_written = bytes_written;
+                s.sections = sections;
+                s.points = points;
+                s.estimated_allocations = estimated_allocations;
+                s.malformed_sections = malformed_sections;
+                s.skipped_sections = skipped_sections;
+                return s;
+            }
+            
+            void reset(){
+                for(auto& e : stage_nanos) e = 0;
+                for(auto& e : decode_nanos) e = 0;
+                for(auto& e : decoded_sections) e = 0;
+                bytes_read = bytes_written = sections = points = estimated_allocations = malformed_sections = skipped_sections = 0;
+            }
+            
+        private:
+            std::array<std::atomic<uint64_t>, num_stages> stage_nanos{};
+            std::array<std::atomic<uint64_t>, num_formats> decode_nanos{};
+            std::array<std::atomic<uint64_t>, num_formats> decoded_sections{};
+            std::atomic<uint64_t> bytes_read{0};
+            std::atomic<uint64_t> bytes_written{0};
+            std::atomic<uint64_t> sections{0};
+            std::atomic<uint64_t> points{0};
+            std::atomic<uint64_t> estimated_allocations{0};
+            std::atomic<uint64_t> malformed_sections{0};
+            std::atomic<uint64_t> skipped_sections{0};
+            callback_type stage_callback;
+        };
+        
+        //shared state of a background load. stays valid after the ilda_file that started it is gone.
+        struct load_handle{
+            void cancel(){ cancel_requested = true; }
+            const bool is_cancelled() const{ return cancel_requested; }
+            const bool is_done() const{ return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+            
+            //blocks until the load finished. false when it failed or was cancelled.
+            const bool wait() const{ return result.get(); }
+            
+            std::size_t get_sections_done() const{ return sections_done; }
+            std::size_t get_sections_total() const{ return sections_total; }
+            uint64_t get_bytes_done() const{ return bytes_done; }
+            uint64_t get_bytes_total() const{ return bytes_total; }
+            float get_progress() const{ return bytes_total ? float(bytes_done) / bytes_total : (is_done() ? 1.0f : 0.0f); }
+            
+            std::atomic<std::size_t> sections_done{0};
+            std::atomic<std::size_t> sections_total{0};
+            std::atomic<uint64_t> bytes_done{0};
+            std::atomic<uint64_t> bytes_total{0};
+            std::atomic<bool> cancel_requested{false};
+            std::shared_future<bool> result;
+        };
+        
+        struct ilda_file{
+            void load(std::string path, LOAD_MODE mode = LOAD_MODE::MemoryMapped){
+                stop_load_thread();
+                close();
+                if(mode == LOAD_MODE::MemoryMapped){
+                    util::mapped_file mapped;
+                    OFX_ILDA_STAT(const uint64_t begin = ilda_stats::now());
+                    const bool is_open = mapped.open(path);
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Open, ilda_stats::now() - begin));
+                    if(is_open){
+                        load_mapped(mapped);
+                        return;
+                    }
+                    ofLogWarning("ofxIldaFile") << "failed map file, fallback to stream : " << path;
+                }
+                load_stream(path);
+            }
+            
+            void load_stream(std::string path){
+                close();
+                OFX_ILDA_STAT(uint64_t begin = ilda_stats::now());
+                std::ifstream ifs(path, std::ios::binary);
+                OFX_ILDA_STAT(stats.add_stage(ilda_stats::Open, ilda_stats::now() - begin));
+                if(ifs){
+                    const std::size_t first = ilda_sections.size();
+                    section_index.clear();
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    uint64_t skipped = 0;
+                    load_functions::build_index(ifs, section_index, &skipped);
+                    OFX_ILDA_STAT(stats.count_skipped(skipped));
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Discovery, ilda_stats::now() - begin));
+                    ofLogNotice("ofxIldaFile") << "succes open file num sections " << section_index.size();
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    for(auto& e : section_index){
+                        ilda_sections.push_back(std::shared_ptr<ilda_section_base>());
+                        ifs.clear();
+                        ifs.seekg(e.offset, std::ios_base::beg);
+                        OFX_ILDA_STAT(const uint64_t section_begin = ilda_stats::now());
+                        const bool loaded = load_functions::load_section(ilda_sections.back(), ifs);
+                        OFX_ILDA_STAT(stats.count_section(e, loaded ? ilda_sections.back().get() : nullptr, ilda_stats::now() - section_begin));
+                        if(!loaded) ilda_sections.pop_back();
+                    }
+                    load_functions::assign_palettes(ilda_sections, first);
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Decode, ilda_stats::now() - begin));
+                    ifs.close();
+                }else{
+                    ofLogError("ofxIldaFile", "filed open file");
+                }
+            }
+            
+            void load_mapped(const util::mapped_file& mapped){
+                close();
+                const uint8_t* bytes = mapped.data();
+                const std::size_t file_size = mapped.size();
+                const std::size_t first = ilda_sections.size();
+                section_index.clear();
+                OFX_ILDA_STAT(uint64_t begin = ilda_stats::now());
+                uint64_t skipped = 0;
+                load_functions::build_index(bytes, file_size, section_index, &skipped);
+                OFX_ILDA_STAT(stats.count_skipped(skipped));
+                OFX_ILDA_STAT(stats.add_stage(ilda_stats::Discovery, ilda_stats::now() - begin));
+                ofLogNotice("ofxIldaFile") << "succes map file file size : " << file_size << " num sections " << section_index.size();
+                OFX_ILDA_STAT(begin = ilda_stats::now());
+                load_functions::duplicate_finder duplicates(bytes, file_size);
+                for(auto& e : section_index){
+                    std::shared_ptr<ilda_section_base> section;
+                    OFX_ILDA_STAT(const uint64_t section_begin = ilda_stats::now());
+                    if(store && duplicates.find(e, section)){
+                        store -> count_loaded(true);
+                        OFX_ILDA_STAT(stats.count_section(e, section.get(), ilda_stats::now() - section_begin));
+                    }else{
+                        const bool loaded = load_functions::load_section(section, bytes + e.offset, file_size - e.offset);
+                        OFX_ILDA_STAT(stats.count_section(e, loaded ? section.get() : nullptr, ilda_stats::now() - section_begin));
+                        if(!loaded) continue;
+                        if(store && section -> format != FORMAT::ColorPalette){
+                            store -> count_loaded(false);
+                            duplicates.add(e, section);
+                        }
+                    }
+                    ilda_sections.push_back(section);
+                }
+                load_functions::assign_palettes(ilda_sections, first);
+                OFX_ILDA_STAT(stats.add_stage(ilda_stats::Decode, ilda_stats::now() - begin));
+            }
+            
+            //decodes the sections on a worker pool once the index is built. each worker reads through its own
+            //reader (the shared mapping, or its own stream in fallback mode) and results keep file order in ilda_sections.
+            void load_parallel(std::string path, std::size_t num_threads = std::thread::hardware_concurrency(), LOAD_MODE mode = LOAD_MODE::MemoryMapped){
+                util::worker_pool pool(num_threads);
+                load_parallel(path, pool, mode);
+            }
+            
+            void load_parallel(std::string path, util::worker_pool& pool, LOAD_MODE mode = LOAD_MODE::MemoryMapped){
+                stop_load_thread();
+                close();
+                const std::size_t first = ilda_sections.size();
+                util::mapped_file mapped;
+                OFX_ILDA_STAT(uint64_t begin = ilda_stats::now());
+                uint64_t skipped = 0;
+                if(mode == LOAD_MODE::MemoryMapped && mapped.open(path)){
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Open, ilda_stats::now() - begin));
+                    const uint8_t* bytes = mapped.data();
+                    const std::size_t file_size = mapped.size();
+                    section_index.clear();
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    load_functions::build_index(bytes, file_size, section_index, &skipped);
+                    OFX_ILDA_STAT(stats.count_skipped(skipped));
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Discovery, ilda_stats::now() - begin));
+                    ofLogNotice("ofxIldaFile") << "succes map file file size : " << file_size << " num sections " << section_index.size() << " workers " << pool.size();
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    ilda_sections.resize(first + section_index.size());
+                    pool.parallel_for(section_index.size(), [&](std::size_t i, std::size_t worker){
+                        const uint64_t offset = section_index[i].offset;
+                        auto& section = ilda_sections[first + i];
+                        OFX_ILDA_STAT(const uint64_t section_begin = ilda_stats::now());
+                        const bool loaded = load_functions::load_section(section, bytes + offset, file_size - offset);
+                        OFX_ILDA_STAT(stats.count_section(section_index[i], loaded ? section.get() : nullptr, ilda_stats::now() - section_begin));
+                    });
+                }else{
+                    if(mode == LOAD_MODE::MemoryMapped) ofLogWarning("ofxIldaFile") << "failed map file, fallback to stream : " << path;
+                    std::ifstream ifs(path, std::ios::binary);
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Open, ilda_stats::now() - begin));
+                    if(!ifs){
+                        ofLogError("ofxIldaFile", "filed open file");
+                        return;
+                    }
+                    section_index.clear();
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    load_functions::build_index(ifs, section_index, &skipped);
+                    OFX_ILDA_STAT(stats.count_skipped(skipped));
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Discovery, ilda_stats::now() - begin));
+                    ofLogNotice("ofxIldaFile") << "succes open file num sections " << section_index.size() << " workers " << pool.size();
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    std::vector<std::unique_ptr<std::ifstream>> readers(pool.size());
+                    ilda_sections.resize(first + section_index.size());
+                    pool.parallel_for(section_index.size(), [&](std::size_t i, std::size_t worker){
+                        auto& reader = readers[worker];
+                        if(!reader) reader.reset(new std::ifstream(path, std::ios::binary));
+                        reader -> clear();
+                        reader -> seekg(section_index[i].offset, std::ios_base::beg);
+                        auto& section = ilda_sections[first + i];
+                        OFX_ILDA_STAT(const uint64_t section_begin = ilda_stats::now());
+                        const bool loaded = load_functions::load_section(section, *reader);
+                        OFX_ILDA_STAT(stats.count_section(section_index[i], loaded ? section.get() : nullptr, ilda_stats::now() - section_begin));
+                    });
+                }
+                drop_empty_sections(first);
+                load_functions::assign_palettes(ilda_sections, first);
+                OFX_ILDA_STAT(stats.add_stage(ilda_stats::Decode, ilda_stats::now() - begin));
+            }
+            
+            //writes ilda_sections[index] back to path, the file they were loaded from. a section with the same encoded size
+            //is overwritten in place, otherwise the file is rewritten from that section on and cut to its new length.
+            //needs a section index matching ilda_sections, as after loading a file without malformed or skipped sections.
+            const bool patch(std::string path, std::size_t index){
+                load_thread_end();
+                if(index >= ilda_sections.size() || section_index.size() != ilda_sections.size()){
+                    ofLogError("ofxIldaFile") << "section index does not match the sections, patch " << index;
+                    return false;
+                }
+                const section_entry& entry = section_index[index];
+                std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+                if(!file){
+                    ofLogError("ofxIldaFile", "filed open file");
+                    return false;
+                }
+                uint8_t header[load_functions::commons::header_size];
+                file.seekg(entry.offset, std::ios_base::beg);
+                file.read((char*)header, sizeof(header));
+                if(file.gcount() != sizeof(header) || !load_functions::commons::read_ilda(header) || header[header_layout::format] != entry.format){
+                    ofLogError("ofxIldaFile") << "no matching header at " << entry.offset << " : " << path;
+                    return false;
+                }
+                
+                const std::size_t old_size = load_functions::commons::header_size + entry.number_of_records * load_functions::commons::record_size((FORMAT)entry.format);
+                const ilda_section_base& section = *ilda_sections[index];
+                if(section.format == entry.format && write_functions::section_size(section) == old_size){
+                    std::vector<uint8_t> buffer(old_size);
+                    write_functions::encode_section(section, buffer.data());
+                    file.seekp(entry.offset, std::ios_base::beg);
+                    file.write((char*)buffer.data(), buffer.size());
+                    file.close();
+                    OFX_ILDA_STAT(stats.count_written(old_size));
+                    ofLogNotice("ofxIldaFile") << "patched section " << index << " in place";
+                    return !file.fail();
+                }
+                
+                file.seekp(entry.offset, std::ios_base::beg);
+                uint64_t end = entry.offset;
+                {
+                    write_functions::buffered_writer writer(file);
+                    for(std::size_t i = index ; i < ilda_sections.size() ; ++i){
+                        writer.write(*ilda_sections[i]);
+                    }
+                    writer.flush();
+                    end += writer.get_bytes_written();
+                    OFX_ILDA_STAT(stats.count_written(writer.get_bytes_written()));
+                }
+                file.close();
+                if(file.fail() || !util::truncate_file(path, end)){
+                    ofLogError("ofxIldaFile") << "failed rewrite tail : " << path;
+                    return false;
+                }
+                uint64_t offset = entry.offset;
+                int32_t palette_section = index ? (section_index[index - 1].format == FORMAT::ColorPalette ? int32_t(index - 1) : section_index[index - 1].palette_section) : -1;
+                for(std::size_t i = index ; i < ilda_sections.size() ; ++i){
+                    section_entry& e = section_index[i];
+                    e.offset = offset;
+                    e.number_of_records = ilda_sections[i] -> number_of_records;
+                    e.format = ilda_sections[i] -> format;
+                    e.palette_section = palette_section;
+                    if(e.format == FORMAT::ColorPalette) palette_section = i;
+                    offset += write_functions::section_size(*ilda_sections[i]);
+                }
+                ofLogNotice("ofxIldaFile") << "rewrote " << ilda_sections.size() - index << " sections from " << entry.offset;
+                return true;
+            }
+            
+            //loads from the sidecar cache next to path (see cache_functions) when it matches the file. otherwise loads path
+            //with mode and, if write_cache, writes a new cache for the next start.
+            void load_cached(std::string path, LOAD_MODE mode = LOAD_MODE::MemoryMapped, bool write_cache = true){
+                stop_load_thread();
+                close();
+                const std::size_t first = ilda_sections.size();
+                OFX_ILDA_STAT(const uint64_t begin = ilda_stats::now());
+                if(cache_functions::load(path, ilda_sections, section_index)){
+                    OFX_ILDA_STAT(for(std::size_t i = first ; i < ilda_sections.size() ; ++i) stats.count_loaded(*ilda_sections[i]));
+                    OFX_ILDA_STAT(uint64_t cache_size);
+                    OFX_ILDA_STAT(int64_t cache_mtime);
+                    OFX_ILDA_STAT(if(util::file_stamp(cache_functions::cache_path(path), cache_size, cache_mtime)) stats.count_read(cache_size));
+                    load_functions::assign_palettes(ilda_sections, first);
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Decode, ilda_stats::now() - begin));
+                    ofLogNotice("ofxIldaFile") << "succes load cache num sections " << ilda_sections.size() - first;
+                    return;
+                }
+                //stamped before loading, a file replaced during the load must not get a cache of the old sections
+                uint64_t source_size;
+                int64_t source_mtime;
+                const bool stamped = util::file_stamp(path, source_size, source_mtime);
+                load(path, mode);
+                if(write_cache && stamped && ilda_sections.size() > first && !cache_functions::write(path, ilda_sections, first, section_index, source_size, source_mtime)){
+                    ofLogWarning("ofxIldaFile") << "failed write cache : " << cache_functions::cache_path(path);
+                }
+            }
+            
+            //opt in duplicate detection. with a store, load skips decoding point sections whose records are byte identical
+            //to an earlier section of the mapped file, copies their points and counts them in the store. null by default.
+            void set_frame_store(const std::shared_ptr<frame_store>& shared_store){ store = shared_store; }
+            const std::shared_ptr<frame_store>& get_frame_store() const{ return store; }
+            
+            //offset table of the last loaded file, one entry per section header in file order.
+            const std::vector<section_entry>& get_section_index() const{
+                return section_index;
+            }
+            
+            //lazy access : open() only builds the section index and keeps the file mapped (or a stream open).
+            //every eager load calls close() first, so frame(i) then serves the loaded ilda_sections again.
+            //frame(i) decodes a section on demand and keeps recently used ones in a LRU cache bounded by get_cache_budget() bytes.
+            const bool open(std::string path, LOAD_MODE mode = LOAD_MODE::MemoryMapped){
+                stop_load_thread();
+                close();
+                std::lock_guard<std::mutex> lock(lazy_mutex);
+                if(mode == LOAD_MODE::MemoryMapped){
+                    lazy_mapped.reset(new util::mapped_file());
+                    if(lazy_mapped -> open(path)){
+                        load_functions::build_index(lazy_mapped -> data(), lazy_mapped -> size(), section_index);
+                        ofLogNotice("ofxIldaFile") << "succes map file num sections " << section_index.size();
+                        return true;
+                    }
+                    lazy_mapped.reset();
+                    ofLogWarning("ofxIldaFile") << "failed map file, fallback to stream : " << path;
+                }
+                lazy_stream.reset(new std::ifstream(path, std::ios::binary));
+                if(!*lazy_stream){
+                    lazy_stream.reset();
+                    ofLogError("ofxIldaFile", "filed open file");
+                    return false;
+                }
+                load_functions::build_index(*lazy_stream, section_index);
+                ofLogNotice("ofxIldaFile") << "succes open file num sections " << section_index.size();
+                return true;
+            }
+            
+            void close(){
+                std::lock_guard<std::mutex> lock(lazy_mutex);
+                lazy_mapped.reset();
+                lazy_stream.reset();
+                section_index.clear();
+                palette_cache.clear();
+                clear_cache_unlocked();
+            }
+            
+            //without open(), falls back to the eagerly loaded ilda_sections. returns nullptr when out of range or malformed.
+            std::shared_ptr<ilda_section_base> frame(std::size_t index){
+                std::lock_guard<std::mutex> lock(lazy_mutex);
+                if(!lazy_mapped && !lazy_stream){
+                    return index < num_loaded_sections() ? ilda_sections[index] : std::shared_ptr<ilda_section_base>();
+                }
+                if(index >= section_index.size()) return std::shared_ptr<ilda_section_base>();
+                
+                auto found = cache_map.find(index);
+                if(found != cache_map.end()){
+                    ++cache_hits;
+                    cache_list.splice(cache_list.begin(), cache_list, found -> second);
+                    return found -> second -> section;
+                }
+                ++cache_misses;
+                
+                std::shared_ptr<ilda_section_base> section = decode_entry(section_index[index]);
+                if(section){
+                    load_functions::set_palette(*section, palette_for(section_index[index]));
+                    cache_insert(index, section);
+                }
+                return section;
+            }
+            
+            //decodes section index straight into arrays, bypassing the cache and the tuple layout.
+            //with resolve_palette, indexed sections come back as the matching true color format, colors looked up in their palette.
+            const bool frame_packed(std::size_t index, packed_section& packed, bool resolve_palette = true){
+                std::lock_guard<std::mutex> lock(lazy_mutex);
+                std::shared_ptr<const ilda_palette> palette;
+                if(!lazy_mapped && !lazy_stream){
+                    if(!(index < num_loaded_sections() && ilda_sections[index] && packed_functions::to_packed(*ilda_sections[index], packed))) return false;
+                    palette = load_functions::get_palette(*ilda_sections[index]);
+                }else{
+                    if(index >= section_index.size()) return false;
+                    const section_entry& entry = section_index[index];
+                    bool loaded;
+                    if(lazy_mapped){
+                        loaded = packed_functions::load_section(packed, lazy_mapped -> data() + entry.offset, lazy_mapped -> size() - entry.offset);
+                    }else{
+                        lazy_stream -> clear();
+                        lazy_stream -> seekg(entry.offset, std::ios_base::beg);
+                        loaded = packed_functions::load_section(packed, *lazy_stream);
+                    }
+                    if(!loaded) return false;
+                    palette = palette_for(entry);
+                }
+                if(resolve_palette) packed_functions::resolve_palette(packed, *palette);
+                return true;
+            }
+            
+            std::size_t num_frames() const{
+                return (lazy_mapped || lazy_stream) ? section_index.size() : num_loaded_sections();
+            }
+            
+            void set_cache_budget(std::size_t bytes){
+                std::lock_guard<std::mutex> lock(lazy_mutex);
+                cache_budget = bytes;
+                cache_evict();
+            }
+            std::size_t get_cache_budget() const{ return cache_budget; }
+            std::size_t get_cache_bytes() const{ return cache_bytes; }
+            uint64_t get_cache_hits() const{ return cache_hits; }
+            uint64_t get_cache_misses() const{ return cache_misses; }
+            
+            void clear_cache(){
+                std::lock_guard<std::mutex> lock(lazy_mutex);
+                clear_cache_unlocked();
+            }
+            
+            ~ilda_file(){
+                stop_load_thread();
+            }
+            
+            //starts loading in the background and returns right away. the index is built before returning,
+            //ilda_sections is sized once and each section is published in file order as soon as it is decoded,
+            //so sections [0, num_loaded_sections()) can be used while the rest of the file is still loading.
+            //sections that fail to decode, or are not reached before a cancel, stay nullptr until the load is joined
+            //by load_thread_end() or the next load, which drops them. write, patch and the frame edits join it first.
+            std::shared_ptr<load_handle> load_async(std::string path, LOAD_MODE mode = LOAD_MODE::MemoryMapped){
+                stop_load_thread();
+                close();
+                
+                std::shared_ptr<load_handle> handle(new load_handle());
+                std::shared_ptr<std::promise<bool>> promise(new std::promise<bool>());
+                handle -> result = promise -> get_future().share();
+                load_task = handle;
+                
+                std::shared_ptr<util::mapped_file> mapped(new util::mapped_file());
+                std::shared_ptr<std::ifstream> ifs;
+                section_index.clear();
+                OFX_ILDA_STAT(uint64_t begin = ilda_stats::now());
+                uint64_t skipped = 0;
+                if(mode == LOAD_MODE::MemoryMapped && mapped -> open(path)){
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Open, ilda_stats::now() - begin));
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    load_functions::build_index(mapped -> data(), mapped -> size(), section_index, &skipped);
+                }else{
+                    mapped.reset();
+                    ifs.reset(new std::ifstream(path, std::ios::binary));
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Open, ilda_stats::now() - begin));
+                    if(!*ifs){
+                        ofLogError("ofxIldaFile", "filed open file");
+                        promise -> set_value(false);
+                        return handle;
+                    }
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    load_functions::build_index(*ifs, section_index, &skipped);
+                }
+                OFX_ILDA_STAT(stats.count_skipped(skipped));
+                OFX_ILDA_STAT(stats.add_stage(ilda_stats::Discovery, ilda_stats::now() - begin));
+                ofLogNotice("ofxIldaFile") << "start async load num sections " << section_index.size();
+                
+                uint64_t bytes_total = 0;
+                for(auto& e : section_index){
+                    bytes_total += load_functions::commons::header_size + e.number_of_records * load_functions::commons::record_size((FORMAT)e.format);
+                }
+                handle -> sections_total = section_index.size();
+                handle -> bytes_total = bytes_total;
+                
+                const std::size_t first = ilda_sections.size();
+                async_first = first;
+                published = first;
+                loading = true;
+                ilda_sections.resize(first + section_index.size());
+                load_thread = std::thread([this, handle, promise, mapped, ifs, first](){
+                    OFX_ILDA_STAT(const uint64_t begin = ilda_stats::now());
+                    std::shared_ptr<const ilda_palette> palette = ilda_palette::default_palette();
+                    bool completed = true;
+                    for(std::size_t i = 0 ; i < section_index.size() ; ++i){
+                        if(handle -> cancel_requested){
+                            completed = false;
+                            break;
+                        }
+                        const section_entry& entry = section_index[i];
+                        std::shared_ptr<ilda_section_base> section;
+                        OFX_ILDA_STAT(const uint64_t section_begin = ilda_stats::now());
+                        if(mapped){
+                            load_functions::load_section(section, mapped -> data() + entry.offset, mapped -> size() - entry.offset);
+                        }else{
+                            ifs -> clear();
+                            ifs -> seekg(entry.offset, std::ios_base::beg);
+                            load_functions::load_section(section, *ifs);
+                        }
+                        OFX_ILDA_STAT(stats.count_section(entry, section.get(), ilda_stats::now() - section_begin));
+                        if(section && section -> format == FORMAT::ColorPalette){
+                            palette = static_cast<const ilda_section<FORMAT::ColorPalette>&>(*section).to_palette();
+                        }else if(section){
+                            load_functions::set_palette(*section, palette);
+                        }
+                        ilda_sections[first + i] = section;
+                        published.store(first + i + 1, std::memory_order_release);
+                        handle -> bytes_done += load_functions::commons::header_size + entry.number_of_records * load_functions::commons::record_size((FORMAT)entry.format);
+                        ++handle -> sections_done;
+                    }
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Decode, ilda_stats::now() - begin));
+                    loading = false;
+                    ofLogNotice("ofxIldaFile") << (completed ? "finish async load" : "cancel async load") << " sections " << handle -> sections_done;
+                    promise -> set_value(completed);
+                });
+                return handle;
+            }
+            
+            //number of leading ilda_sections that are safe to read, also while load_async is running.
+            std::size_t num_loaded_sections() const{
+                return loading ? published.load(std::memory_order_acquire) : ilda_sections.size();
+            }
+            
+            void load_thread_start(std::string path){
+                load_async(path);
+            }
+            void load_thread_end(){
+                if(load_task) load_task -> wait();
+                join_load_thread();
+            }
+            
+            void write(std::string path, WRITE_MODE mode = WRITE_MODE::Buffered){
+                load_thread_end();
+                OFX_ILDA_STAT(uint64_t begin = ilda_stats::now());
+                if(mode == WRITE_MODE::MappedOutput){
+                    if(write_functions::write_mapped(ilda_sections, path)){
+                        OFX_ILDA_STAT(stats.add_stage(ilda_stats::Write, ilda_stats::now() - begin));
+                        OFX_ILDA_STAT(for(auto& e : ilda_sections) stats.count_written(write_functions::section_size(*e)));
+                        ofLogNotice("ofxIldaFile") << "finish save num sections " << ilda_sections.size();
+                        return;
+                    }
+                    ofLogWarning("ofxIldaFile") << "failed map output, fallback to buffered : " << path;
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                }
+                std::ofstream ofs(path, std::ios::binary);
+                OFX_ILDA_STAT(stats.add_stage(ilda_stats::Open, ilda_stats::now() - begin));
+                if(ofs){
+                    ofLogNotice("ofxIldaFile") << "succes open file";
+                    ofLogNotice("ofxIldaFile") << "num sections " << ilda_sections.size();
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    write_functions::buffered_writer writer(ofs);
+                    for(auto& e : ilda_sections){
+                        writer.write(*e);
+                    }
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Write, ilda_stats::now() - begin));
+                    OFX_ILDA_STAT(begin = ilda_stats::now());
+                    writer.flush();
+                    ofs.close();
+                    OFX_ILDA_STAT(stats.count_written(writer.get_bytes_written()));
+                    OFX_ILDA_STAT(stats.add_stage(ilda_stats::Flush, ilda_stats::now() - begin));
+                    ofLogNotice("ofxIldaFile") << "finish save";
+                }else{
+                    ofLogError("ofxIldaFile", "filed open file");
+                }
+            }
+            
+            //meshes used by test_dev_draw. call invalidate on it after editing points of a section in place.
+            preview_renderer& get_preview(){ return preview; }
+            
+            //reorders and blanks every frame for scanning, see optimize_functions.
+            optimize_functions::optimize_result optimize(const optimize_functions::optimize_settings& settings = optimize_functions::optimize_settings(), std::size_t num_threads = std::thread::hardware_concurrency()){
+                util::worker_pool pool(num_threads);
+                return optimize(settings, pool);
+            }
+            
+            optimize_functions::optimize_result optimize(const optimize_functions::optimize_settings& settings, util::worker_pool& pool){
+                load_thread_end();
+                const optimize_functions::optimize_result result = optimize_functions::optimize(ilda_sections, settings, pool);
+                ofLogNotice("ofxIldaFile") << "optimized points " << result.points_before << " -> " << result.points_after << ", travel " << result.travel_before << " -> " << result.travel_after;
+                return result;
+            }
+            
+            //brings every frame to target points, see resample_functions.
+            resample_functions::resample_result resample(std::size_t target, const resample_functions::resample_settings& settings = resample_functions::resample_settings(), std::size_t num_threads = std::thread::hardware_concurrency()){
+                util::worker_pool pool(num_threads);
+                return resample(target, settings, pool);
+            }
+            
+            resample_functions::resample_result resample(std::size_t target, const resample_functions::resample_settings& settings, util::worker_pool& pool){
+                load_thread_end();
+                const resample_functions::resample_result result = resample_functions::resample(ilda_sections, target, settings, pool);
+                ofLogNotice("ofxIldaFile") << "resampled sections " << result.sections << " to " << target << " points, over budget " << result.over_budget;
+                if(result.over_budget) ofLogWarning("ofxIldaFile") << result.over_budget << " sections have more blanking edges than " << target << " points";
+                return result;
+            }
+            
+            //timings and counters of every load, frame and write. poll get_stats().get() or hook set_callback.
+            ilda_stats& get_stats(){ return stats; }
+            const ilda_stats& get_stats() const{ return stats; }
+            void reset_stats(){ stats.reset(); }
+            
+            const std::string test_dev_draw(std::size_t index, float scale = ofGetHeight() / 2.0){
+                const std::size_t num_sections = num_loaded_sections();
+                if(num_sections == 0) return "";
+                index = index % num_sections;
+                auto& section = ilda_sections[index];
+                if(!section) return "";
+                ofPushStyle();
+                preview.draw(section, scale / 32767.0);
+                ofPopStyle();
+                std::stringstream ss("");
+                ss
+                << "index              : " << index << "\n"
+                << "frame name         : " << section -> name << "\n"
+                << "company name       : " << section -> company_name << "\n"
+                << "number_of_records  : " << section -> number_of_records << "\n"
+                << "frame number       : " << section -> frame_number << "\n"
+                << "total frames       : " << section -> total_frames << std::endl;
+                return ss.str();
+            }
+            
+            std::vector<std::shared_ptr<ilda_section_base>> ilda_sections;
+        private:
+            //a new load cancels a running background load first, it shares section_index and ilda_sections with it.
+            void stop_load_thread(){
+                if(load_task) load_task -> cancel();
+                join_load_thread();
             }
-        };
-        
-        enum FORMAT{
-            Coordinates3D = 0,
-            Coordinates2D = 1,
-            ColorPalette = 2,
-            Coordinates3DwTrueColor = 4,
-            Coordinates2DwTrueColor = 5,
-        };
-        
-        struct ilda_section_base{
-            FORMAT format;
-            std::string name;
-            std::string company_name;
-            uint16_t number_of_records;
-            uint16_t frame_number;
-            uint16_t total_frames;
-            uint8_t projector_number;
-            uint8_t none;
-        };
-        
-        template<FORMAT format_type>
-        struct ilda_section : ilda_section_base{};
-        
-        template<> struct ilda_section<FORMAT::Coordinates3D> : ilda_section_base{ std::vector<std::tuple<ofVec3f, uint8_t, uint8_t>> data; };
-        template<> struct ilda_section<FORMAT::Coordinates2D> : ilda_section_base{ std::vector<std::tuple<ofVec2f, uint8_t, uint8_t>> data; };
-        template<> struct ilda_section<FORMAT::ColorPalette> : ilda_section_base{std::array<ofColor, 255> data; };
-        template<> struct ilda_section<FORMAT::Coordinates3DwTrueColor> : ilda_section_base{ std::vector<std::tuple<ofVec3f, uint8_t, ofColor>> data; };
-        template<> struct ilda_section<FORMAT::Coordinates2DwTrueColor> : ilda_section_base{ std::vector<std::tuple<ofVec2f, uint8_t, ofColor>> data; };
-        
-        namespace load_functions{
-            namespace commons{
-                const bool read_ilda(std::ifstream& ifs){
-                    char head[5];
-                    head[4] = NULL;
-                    ifs.read((char*)&head,4);
-                    return (strncmp(head,"ILDA",4) == 0);
+            
+            //the slots a background load left empty are dropped once its thread is joined
+            void join_load_thread(){
+                if(!load_thread.joinable()) return;
+                load_thread.join();
+                drop_empty_sections(async_first);
+            }
+            
+            void drop_empty_sections(std::size_t first){
+                ilda_sections.erase(std::remove(ilda_sections.begin() + std::min(first, ilda_sections.size()), ilda_sections.end(), std::shared_ptr<ilda_section_base>()), ilda_sections.end());
+            }
+            
+            //lazy_mutex held
+            std::shared_ptr<ilda_section_base> decode_entry(const section_entry& entry){
+                std::shared_ptr<ilda_section_base> section;
+                OFX_ILDA_STAT(const uint64_t begin = ilda_stats::now());
+                if(lazy_mapped){
+                    load_functions::load_section(section, lazy_mapped -> data() + entry.offset, lazy_mapped -> size() - entry.offset);
+                }else{
+                    lazy_stream -> clear();
+                    lazy_stream -> seekg(entry.offset, std::ios_base::beg);
+                    load_functions::load_section(section, *lazy_stream);
                 }
-                
-                void read_header(std::shared_ptr<ilda_section_base>& section_base, std::ifstream& ifs){
-                    char name_buf[9];
-                    name_buf[8] = NULL;
-                    ifs.read((char*)&name_buf, 8);
-                    section_base -> name = std::string(name_buf);
-                    ifs.read((char*)&name_buf, 8);
-                    section_base -> company_name = std::string(name_buf);
-                    uint16_t bit16_buf;
-                    ifs.read((char*)&bit16_buf, 2);
-                    section_base -> number_of_records = util::reverse_16b(bit16_buf);
-                    ifs.read((char*)&bit16_buf, 2);
-                    section_base -> frame_number = util::reverse_16b(bit16_buf);
-                    ifs.read((char*)&bit16_buf, 2);
-                    section_base -> total_frames = util::reverse_16b(bit16_buf);
-                    ifs.read((char*)&section_base -> projector_number, 1);
-                    ifs.read((char*)&section_base -> none, 1);
+                //section stays null when decoding failed
+                OFX_ILDA_STAT(stats.count_section(entry, section.get(), ilda_stats::now() - begin));
+                return section;
+            }
+            
+            //lazy_mutex held. palette sections are decoded once and kept for the lifetime of the open file.
+            std::shared_ptr<const ilda_palette> palette_for(const section_entry& entry){
+                if(entry.palette_section < 0) return ilda_palette::default_palette();
+                auto found = palette_cache.find(entry.palette_section);
+                if(found != palette_cache.end()) return found -> second;
+                std::shared_ptr<const ilda_palette> palette = ilda_palette::default_palette();
+                std::shared_ptr<ilda_section_base> section = decode_entry(section_index[entry.palette_section]);
+                if(section && section -> format == FORMAT::ColorPalette){
+                    palette = static_cast<const ilda_section<FORMAT::ColorPalette>&>(*section).to_palette();
                 }
+                palette_cache[entry.palette_section] = palette;
+                return palette;
+            }
+            
+            struct cache_entry{
+                std::size_t index;
+                std::shared_ptr<ilda_section_base> section;
+                std::size_t bytes;
             };
             
-            template<FORMAT format> void type_load(ilda_section<format>& section, std::ifstream& ifs){}
-            template<> void type_load(ilda_section<FORMAT::Coordinates3D>& section, std::ifstream& ifs){
-                //TODO:
+            void cache_insert(std::size_t index, const std::shared_ptr<ilda_section_base>& section){
+                const std::size_t bytes = memory_size(*section);
+                if(bytes > cache_budget) return;
+                cache_list.push_front(cache_entry{index, section, bytes});
+                cache_map[index] = cache_list.begin();
+                cache_bytes += bytes;
+                cache_evict();
             }
-            template<> void type_load(ilda_section<FORMAT::Coordinates2D>& section, std::ifstream& ifs){
-                //TODO:
+            
+            void cache_evict(){
+                while(cache_bytes > cache_budget && !cache_list.empty()){
+                    auto& last = cache_list.back();
+                    cache_bytes -= last.bytes;
+                    cache_map.erase(last.index);
+                    cache_list.pop_back();
+                }
             }
-            template<> void type_load(ilda_section<FORMAT::ColorPalette>& section, std::ifstream& ifs){
-                //TODO:
+            
+            void clear_cache_unlocked(){
+                cache_list.clear();
+                cache_map.clear();
+                cache_bytes = 0;
             }
             
-            template<> void type_load(ilda_section<FORMAT::Coordinates3DwTrueColor>& section, std::ifstream& ifs){
-                int16_t pos_buf[3];
-                uint8_t col_buf[3];
-                
-                for(std::size_t i = 0 ; i <  section.number_of_records ; ++i){
-                    section.data.emplace_back();
-                    auto& d = section.data.back();
-                    auto& pos = std::get<0>(d);
-                    uint8_t& status = std::get<1>(d);
-                    auto& color = std::get<2>(d);
-          
-                    ifs.read((char*)&pos_buf, 6);
-                    ifs.read((char*)&status, 1);
-                    ifs.read((char*)&col_buf, 3);
-                    
-                    pos.x = util::reverse_16b(pos_buf[0]);
-                    pos.y = util::reverse_16b(pos_buf[1]);
-                    pos.z = util::reverse_16b(pos_buf[2]);
-                    
-                    color.set(col_buf[0], col_buf[1], col_buf[2]);
+            std::vector<section_entry> section_index;
+            std::unique_ptr<util::mapped_file> lazy_mapped;
+            std::unique_ptr<std::ifstream> lazy_stream;
+            std::mutex lazy_mutex;
+            std::map<int32_t, std::shared_ptr<const ilda_palette>> palette_cache;
+            std::list<cache_entry> cache_list;
+            std::unordered_map<std::size_t, std::list<cache_entry>::iterator> cache_map;
+            std::size_t cache_budget = 64 * 1024 * 1024;
+            std::atomic<std::size_t> cache_bytes{0};
+            std::atomic<uint64_t> cache_hits{0};
+            std::atomic<uint64_t> cache_misses{0};
+            std::shared_ptr<load_handle> load_task;
+            std::thread load_thread;
+            std::atomic<bool> loading{false};
+            std::atomic<std::size_t> published{0};
+            std::size_t async_first = 0;
+            preview_renderer preview;
+            std::shared_ptr<frame_store> store;
+            ilda_stats stats;
+        };
+        
+        //append mode writer for live recording. each frame is appended to the file as it arrives, numbered in recording order.
+        //close() appends the end of file section and fixes up total_frames in every point section header, so a recording costs
+        //one write per frame plus one small write per frame on close. open with append continues an existing file.
+        struct ilda_recorder{
+            ilda_recorder(){}
+            ilda_recorder(const ilda_recorder&) = delete;
+            ilda_recorder& operator=(const ilda_recorder&) = delete;
+            ~ilda_recorder(){ close(); }
+            
+            const bool open(std::string file_path, bool append = false, std::string frame_name = "hogehoge", std::string company_name = "ofxIldaF"){
+                close();
+                header.format = FORMAT::Coordinates2DwTrueColor;
+                header.name = frame_name;
+                header.company_name = company_name;
+                header.number_of_records = 0;
+                header.frame_number = 0;
+                header.total_frames = 0;
+                header.projector_number = 0;
+                header.none = 0;
+                offsets.clear();
+                end = 0;
+                if(append){
+                    //keeps every section up to the end of file section, which is written again on close
+                    std::vector<section_entry> index;
+                    {
+                        util::mapped_file mapped;
+                        if(mapped.open(file_path)) load_functions::build_index(mapped.data(), mapped.size(), index);
+                    }
+                    //a file without ilda sections is not ours to overwrite
+                    uint64_t size;
+                    int64_t mtime;
+                    if(index.empty() && util::file_stamp(file_path, size, mtime) && size){
+                        ofLogError("ofxIldaFile") << "not an ilda file, refuse to append : " << file_path;
+                        return false;
+                    }
+                    for(auto& e : index){
+                        if(e.number_of_records == 0) break;
+                        if(e.format != FORMAT::ColorPalette) offsets.push_back(e.offset);
+                        end = e.offset + load_functions::commons::header_size + e.number_of_records * load_functions::commons::record_size((FORMAT)e.format);
+                    }
+                    if(!index.empty() && !util::truncate_file(file_path, end)){
+                        ofLogError("ofxIldaFile") << "failed truncate for append : " << file_path;
+                        return false;
+                    }
+                }
+                file.open(file_path, std::ios::in | std::ios::out | std::ios::binary | (end ? std::ios::openmode() : std::ios::trunc));
+                if(!file){
+                    ofLogError("ofxIldaFile", "filed open file");
+                    return false;
                 }
+                file.seekp(end, std::ios_base::beg);
+                path = file_path;
+                ofLogNotice("ofxIldaFile") << "start recording " << path << " frames " << offsets.size();
+                return true;
             }
             
-            template<> void type_load(ilda_section<FORMAT::Coordinates2DwTrueColor>& section, std::ifstream& ifs){
-                int16_t pos_buf[2];
-                uint8_t col_buf[2];
-                
-                for(std::size_t i = 0 ; i <  section.number_of_records ; ++i){
-                    section.data.emplace_back();
-                    auto& d = section.data.back();
-                    auto& pos = std::get<0>(d);
-                    uint8_t& status = std::get<1>(d);
-                    auto& color = std::get<2>(d);
-                    
-                    ifs.read((char*)&pos_buf, 4);
-                    ifs.read((char*)&status, 1);
-                    ifs.read((char*)&col_buf, 3);
-                    
-                    pos.x = util::reverse_16b(pos_buf[0]);
-                    pos.y = util::reverse_16b(pos_buf[1]);
-                    
-                    color.set(col_buf[0], col_buf[1], col_buf[2]);
+            const bool is_open() const{ return file.is_open(); }
+            
+            //name, company and format used for recorded frames
+            const ilda_section_base& get_header() const{ return header; }
+            
+            //one encoded section, header included. frame_number of a point section is set to the recording position,
+            //palette sections are written as they are and not counted as frames.
+            void append(std::vector<uint8_t>& encoded){
+                if(!is_open() || encoded.size() < load_functions::commons::header_size) return;
+                if(encoded[header_layout::format] != FORMAT::ColorPalette){
+                    util::write_16b(encoded.data() + header_layout::frame_number, uint16_t(offsets.size()));
+                    offsets.push_back(end);
                 }
+                file.write((char*)encoded.data(), encoded.size());
+                end += encoded.size();
             }
             
-            const bool load_section(std::shared_ptr<ilda_section_base>& section_base, std::ifstream& ifs){
-                commons::read_ilda(ifs);
-                ifs.seekg(3 * sizeof(char), std::ios::cur);
-                uint8_t type;
-                ifs.read((char*)&type, 1);
-                
-                switch ((FORMAT)type){
-                    case FORMAT::Coordinates3D :
-                        section_base.reset(new ilda_section<FORMAT::Coordinates3D>());
-                        break;
-                    
-                    case FORMAT::Coordinates2D :
-                        section_base.reset(new ilda_section<FORMAT::Coordinates2D>());
-                        break;
-                    
-                    case FORMAT::ColorPalette :
-                        section_base.reset(new ilda_section<FORMAT::ColorPalette>());
-                        break;
-                    
-                    case FORMAT::Coordinates3DwTrueColor :
-                        section_base.reset(new ilda_section<FORMAT::Coordinates3DwTrueColor>());
-                        break;
-                    
-                    case FORMAT::Coordinates2DwTrueColor :
-                        section_base.reset(new ilda_section<FORMAT::Coordinates2DwTrueColor>());
-                        break;
-                    default:
-                        break;
-                }
-                
-                section_base -> format = (FORMAT)type;
-                commons::read_header(section_base, ifs);
-                
-                switch (section_base -> format){
-                    case FORMAT::Coordinates3D :
-                        type_load(*(ilda_section<FORMAT::Coordinates3D>*)section_base.get(), ifs);
-                        break;
-                    
-                    case FORMAT::Coordinates2D :
-                        type_load(*(ilda_section<FORMAT::Coordinates2D>*)section_base.get(), ifs);
-                        break;
-                    
-                    case FORMAT::ColorPalette :
-                        type_load(*(ilda_section<FORMAT::ColorPalette>*)section_base.get(), ifs);
-                        break;
-                    
-                    case FORMAT::Coordinates3DwTrueColor :
-                        type_load(*(ilda_section<FORMAT::Coordinates3DwTrueColor>*)section_base.get(), ifs);
-                        break;
-                    
-                    case FORMAT::Coordinates2DwTrueColor :
-                        type_load(*(ilda_section<FORMAT::Coordinates2DwTrueColor>*)section_base.get(), ifs);
-                        break;
-                    default:
-                        break;
+            void record(const ilda_section_base& section){
+                if(!is_open()) return;
+                buffer.resize(write_functions::section_size(section));
+                write_functions::encode_section(section, buffer.data());
+                append(buffer);
+            }
+            
+            const bool close(){
+                if(!is_open()) return false;
+                const uint16_t total_frames = offsets.size();
+                ilda_section_base end_of_file = header;
+                end_of_file.frame_number = total_frames;
+                end_of_file.total_frames = total_frames;
+                uint8_t bytes[load_functions::commons::header_size];
+                write_functions::commons::encode_header(end_of_file, bytes);
+                file.write((char*)bytes, sizeof(bytes));
+                util::write_16b(bytes, total_frames);
+                for(auto offset : offsets){
+                    file.seekp(offset + header_layout::total_frames, std::ios_base::beg);
+                    file.write((char*)bytes, 2);
                 }
+                file.close();
+                const bool done = !file.fail();
+                ofLogNotice("ofxIldaFile") << "finish recording " << path << " frames " << total_frames << " bytes " << end + sizeof(bytes);
+                offsets.clear();
+                return done;
             }
+            
+            std::size_t get_num_frames() const{ return offsets.size(); }
+            uint64_t get_bytes_written() const{ return end; }
+            
+        private:
+            std::fstream file;
+            std::string path;
+            ilda_section_base header;
+            //headers of the point sections, the ones counted as frames
+            std::vector<uint64_t> offsets;
+            uint64_t end = 0;
+            std::vector<uint8_t> buffer;
         };
         
-        namespace write_functions{
-            namespace commons{
-                void write_header(std::shared_ptr<ilda_section_base>& section_base, std::ofstream& ofs){
-                    char head[5] = "ILDA";
-                    ofs.write((char*)head,4);
-                    uint8_t type_buf[4] = {0,0,0, uint8_t(section_base -> format)};
-                    ofs.write((char*)type_buf, 4);
-                    ofs.write((char*)section_base -> name.c_str(), 8);
-                    ofs.write((char*)section_base -> company_name.c_str(), 8);
-                    uint16_t bit16_buf = util::reverse_16b(section_base -> number_of_records);
-                    ofs.write((char*)&bit16_buf, 2);
-                    bit16_buf = util::reverse_16b(section_base -> frame_number);
-                    ofs.write((char*)&bit16_buf, 2);
-                    bit16_buf = util::reverse_16b(section_base -> total_frames);
-                    ofs.write((char*)&bit16_buf, 2);
-                    ofs.write((char*)&section_base -> projector_number, 1);
-                    ofs.write((char*)&section_base -> none, 1);
-                }
+        //splits the frames of a show by projector_number and plays every projector from its own consumer thread.
+        //one feeder thread keeps a lock free single producer / single consumer queue per projector filled,
+        //each consumer pops one frame per period of its frame rate and hands it to the output callback.
+        //an empty queue at a deadline is an underrun, the last frame is output again.
+        struct projector_demux{
+            typedef std::function<void(uint8_t, const std::shared_ptr<ilda_section_base>&)> output_type;
+            
+            struct projector_stats{
+                uint64_t frames = 0;
+                uint64_t underruns = 0;
+                //outputs that finished after the next deadline, and the worst lateness
+                uint64_t late_frames = 0;
+                uint64_t max_late_nanos = 0;
+                std::size_t queued = 0;
             };
             
-            template<FORMAT format> void type_write(ilda_section<format>& section, std::ofstream& ofs){}
-            template<> void type_write(ilda_section<FORMAT::Coordinates3D>& section, std::ofstream& ofs){
-                //TODO:
+            projector_demux(){}
+            projector_demux(const projector_demux&) = delete;
+            projector_demux& operator=(const projector_demux&) = delete;
+            ~projector_demux(){ stop(); }
+            
+            //indexes the point sections by projector number, in order. palettes and end of file sections are skipped.
+            void set_sections(const std::vector<std::shared_ptr<ilda_section_base>>& sections){
+                stop();
+                lanes.clear();
+                for(auto& e : sections){
+                    if(!e || e -> format == FORMAT::ColorPalette || e -> number_of_records == 0) continue;
+                    get_lane(e -> projector_number, true) -> frames.push_back(e);
+                }
             }
-            template<> void type_write(ilda_section<FORMAT::Coordinates2D>& section, std::ofstream& ofs){
-                //TODO:
+            
+            std::vector<uint8_t> get_projectors() const{
+                std::vector<uint8_t> projectors;
+                for(auto& l : lanes) projectors.push_back(l -> projector);
+                return projectors;
             }
-            template<> void type_write(ilda_section<FORMAT::ColorPalette>& section, std::ofstream& ofs){
-                //TODO:
+            
+            const std::vector<std::shared_ptr<ilda_section_base>>& get_frames(uint8_t projector) const{
+                static const std::vector<std::shared_ptr<ilda_section_base>> empty;
+                const lane* l = get_lane(projector);
+                return l ? l -> frames : empty;
             }
             
-            template<> void type_write(ilda_section<FORMAT::Coordinates3DwTrueColor>& section, std::ofstream& ofs){
-                int16_t pos_buf[3];
-                uint8_t col_buf[3];
-
-                for(std::size_t i = 0 ; i <  section.number_of_records ; ++i){
-                    auto& d = section.data[i];
-                    auto& pos = std::get<0>(d);
-                    uint8_t& status = std::get<1>(d);
-                    auto& color = std::get<2>(d);
-
-                    pos_buf[0] = pos.x;
-                    pos_buf[0] = util::reverse_16b(pos_buf[0]);
-                    pos_buf[1] = pos.y;
-                    pos_buf[1] = util::reverse_16b(pos_buf[1]);
-                    pos_buf[2] = pos.z;
-                    pos_buf[2] = util::reverse_16b(pos_buf[2]);
-
-                    col_buf[0] = color.b;
-                    col_buf[1] = color.g;
-                    col_buf[2] = color.r;
-                    
-                    ofs.write((char*)&pos_buf, 6);
-                    ofs.write((char*)&status, 1);
-                    ofs.write((char*)&col_buf, 3);
+            //frame rate of one projector, 0 uses the rate given to start. call before start.
+            void set_frame_rate(uint8_t projector, float frames_per_second){
+                lane* l = get_lane(projector);
+                if(l) l -> frames_per_second = frames_per_second;
+            }
+            
+            //output is called from the consumer thread of each projector. with loop false a projector stops after its last frame.
+            const bool start(output_type output, float frames_per_second, bool loop = true, std::size_t queue_size = 8){
+                stop();
+                if(lanes.empty() || frames_per_second <= 0 || !output) return false;
+                running = true;
+                for(auto& l : lanes){
+                    l -> queue.reset(new util::spsc_queue<std::shared_ptr<ilda_section_base>>(queue_size));
+                    l -> next = 0;
+                    l -> finished = false;
+                    l -> done = false;
+                    l -> frames_output = l -> underruns = l -> late_frames = l -> max_late_nanos = 0;
+                    while(fill(*l, loop));
                 }
+                for(auto& l : lanes){
+                    lane* current = l.get();
+                    const float rate = current -> frames_per_second > 0 ? current -> frames_per_second : frames_per_second;
+                    current -> consumer = std::thread([this, current, output, rate](){ consume(*current, output, rate); });
+                }
+                feeder = std::thread([this, loop](){ feed(loop); });
+                return true;
             }
             
-            template<> void type_write(ilda_section<FORMAT::Coordinates2DwTrueColor>& section, std::ofstream& ofs){
-                int16_t pos_buf[2];
-                uint8_t col_buf[3];
-                
-                for(std::size_t i = 0 ; i <  section.number_of_records ; ++i){
-                    auto& d = section.data[i];
-                    auto& pos = std::get<0>(d);
-                    uint8_t& status = std::get<1>(d);
-                    auto& color = std::get<2>(d);
-                    
-                    pos_buf[0] = pos.x;
-                    pos_buf[0] = util::reverse_16b(pos_buf[0]);
-                    pos_buf[1] = pos.y;
-                    pos_buf[1] = util::reverse_16b(pos_buf[1]);
-                    
-                    col_buf[0] = color.b;
-                    col_buf[1] = color.g;
-                    col_buf[2] = color.r;
-                    
-                    ofs.write((char*)&pos_buf, 4);
-                    ofs.write((char*)&status, 1);
-                    ofs.write((char*)&col_buf, 3);
+            void stop(){
+                running = false;
+                if(feeder.joinable()) feeder.join();
+                for(auto& l : lanes) if(l -> consumer.joinable()) l -> consumer.join();
+            }
+            
+            const bool is_running() const{ return running; }
+            
+            //true once every projector output its last frame (loop false) or after stop() of a started demux
+            const bool is_finished() const{
+                for(auto& l : lanes) if(!l -> done) return false;
+                return true;
+            }
+            
+            projector_stats get_stats(uint8_t projector) const{
+                projector_stats s;
+                const lane* l = get_lane(projector);
+                if(!l) return s;
+                s.frames = l -> frames_output;
+                s.underruns = l -> underruns;
+                s.late_frames = l -> late_frames;
+                s.max_late_nanos = l -> max_late_nanos;
+                s.queued = l -> queue ? l -> queue -> size() : 0;
+                return s;
+            }
+            
+        private:
+            struct lane{
+                uint8_t projector;
+                std::vector<std::shared_ptr<ilda_section_base>> frames;
+                float frames_per_second = 0;
+                std::unique_ptr<util::spsc_queue<std::shared_ptr<ilda_section_base>>> queue;
+                //feeder side
+                std::size_t next = 0;
+                std::atomic<bool> finished{false};
+                //consumer side
+                std::thread consumer;
+                std::atomic<bool> done{false};
+                std::atomic<uint64_t> frames_output{0};
+                std::atomic<uint64_t> underruns{0};
+                std::atomic<uint64_t> late_frames{0};
+                std::atomic<uint64_t> max_late_nanos{0};
+            };
+            
+            lane* get_lane(uint8_t projector, bool create = false){
+                for(auto& l : lanes) if(l -> projector == projector) return l.get();
+                if(!create) return nullptr;
+                lanes.emplace_back(new lane());
+                lanes.back() -> projector = projector;
+                return lanes.back().get();
+            }
+            
+            const lane* get_lane(uint8_t projector) const{
+                for(auto& l : lanes) if(l -> projector == projector) return l.get();
+                return nullptr;
+            }
+            
+            //pushes the next frame of a lane, false when its queue is full or it has no more frames
+            const bool fill(lane& l, bool loop){
+                if(l.finished) return false;
+                if(l.next >= l.frames.size()){
+                    if(!loop || l.frames.empty()){
+                        l.finished = true;
+                        return false;
+                    }
+                    l.next = 0;
                 }
+                if(!l.queue -> push(l.frames[l.next])) return false;
+                ++l.next;
+                return true;
             }
             
-            void write_sections(std::shared_ptr<ilda_section_base>& section_base, std::ofstream& ofs){
-                commons::write_header(section_base, ofs);
-                switch (section_base -> format){
-                    case FORMAT::Coordinates3D :
-                        type_write(*(ilda_section<FORMAT::Coordinates3D>*)section_base.get(), ofs);
-                        break;
-                    
-                    case FORMAT::Coordinates2D :
-                        type_write(*(ilda_section<FORMAT::Coordinates2D>*)section_base.get(), ofs);
-                        break;
-                    
-                    case FORMAT::ColorPalette :
-                        type_write(*(ilda_section<FORMAT::ColorPalette>*)section_base.get(), ofs);
-                        break;
-                    
-                    case FORMAT::Coordinates3DwTrueColor :
-                        type_write(*(ilda_section<FORMAT::Coordinates3DwTrueColor>*)section_base.get(), ofs);
-                        break;
-                    
-                    case FORMAT::Coordinates2DwTrueColor :
-                        type_write(*(ilda_section<FORMAT::Coordinates2DwTrueColor>*)section_base.get(), ofs);
-                        break;
-                    default:
-                        break;
+            void feed(bool loop){
+                while(running){
+                    bool active = false;
+                    bool pushed = false;
+                    for(auto& l : lanes){
+                        while(fill(*l, loop)) pushed = true;
+                        if(!l -> finished) active = true;
+                    }
+                    if(!active) return;
+                    if(!pushed) std::this_thread::sleep_for(std::chrono::microseconds(500));
                 }
             }
-        };
-        
-        struct ilda_file{
-            void load(std::string path){
-                std::ifstream ifs(path, std::ios::binary);
-                if(ifs){
-                    ifs.seekg(0, std::ios_base::end);
-                    ifstream::pos_type file_size = ifs.tellg();
-                    ifs.clear();
-                    ifs.seekg(0, std::ios_base::beg);
-                    ofLogNotice("ofxIldaFile") << "succes open file file size : " << file_size;
-                    std::vector<ifstream::pos_type> section_heads;
-                    
-                    uint8_t eof_buf;
-                    while(ifs.tellg() >= 0){
-                        ifstream::pos_type current = ifs.tellg();
-                        if(load_functions::commons::read_ilda(ifs)){
-                            section_heads.push_back(current);
-                        }else{
-                            ifs.seekg(-3, std::ios_base::cur);
-                            ifs.read((char*)&eof_buf, 1);
-                        }
+            
+            //deadlines advance by a fixed period so pacing does not drift. after a stall longer than a period
+            //the schedule restarts from now instead of bursting frames to catch up.
+            void consume(lane& l, output_type output, float frames_per_second){
+                typedef std::chrono::steady_clock clock;
+                const clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / frames_per_second));
+                clock::time_point deadline = clock::now();
+                std::shared_ptr<ilda_section_base> frame;
+                while(running){
+                    if(!l.queue -> pop(frame)){
+                        if(l.finished && l.queue -> size() == 0) break;
+                        ++l.underruns;
                     }
-                    ofLogNotice("ofxIldaFile") << "num sections " << section_heads.size();
-                    ifs.clear();
-                    for(auto& e : section_heads){
-                        ilda_sections.push_back(std::shared_ptr<ilda_section_base>());
-                        ifs.seekg(e, std::ios_base::beg);
-                        load_functions::load_section(ilda_sections.back(), ifs);
+                    if(frame){
+                        output(l.projector, frame);
+                        ++l.frames_output;
+                    }
+                    deadline += period;
+                    const clock::time_point now = clock::now();
+                    if(now > deadline){
+                        const uint64_t late = std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count();
+                        ++l.late_frames;
+                        if(late > l.max_late_nanos) l.max_late_nanos = late;
+                        if(now - deadline > period) deadline = now;
+                    }else{
+                        std::this_thread::sleep_until(deadline);
                     }
-                    ifs.close();
-                }else{
-                    ofLogError("ofxIldaFile", "filed open file");
                 }
+                l.done = true;
             }
             
-            void load_thread_start(std::string path){
-                path_buf = path;
-                std::thread([&](){
-                    load_mutex.lock();
-                    load(path_buf);
-                    load_mutex.unlock();
-                }).detach();
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::vector<std::unique_ptr<lane>> lanes;
+            std::thread feeder;
+            std::atomic<bool> running{false};
+        };
+        
+        //one published version of a hot reloaded file. never modified after it is published, readers may use it
+        //from any thread for as long as they hold the shared_ptr, the last holder frees it.
+        struct ilda_snapshot{
+            std::vector<std::shared_ptr<ilda_section_base>> ilda_sections;
+            std::vector<section_entry> section_index;
+            //hash of each section's bytes, to find candidates for reuse in the next version
+            std::vector<uint64_t> section_hashes;
+            uint64_t version = 0;
+        };
+        
+        //watches a file and republishes it whenever it changes on disk. the new version is decoded on the watcher thread
+        //and swapped in with one atomic pointer exchange, so get() never waits for a reload and takes no lock.
+        //sections whose bytes did not change are taken over from the previous snapshot as the same objects,
+        //only edited sections are decoded.
+        struct ilda_hot_reload{
+            typedef std::function<void(const std::shared_ptr<const ilda_snapshot>&)> callback_type;
+            
+            ilda_hot_reload(){}
+            ilda_hot_reload(const ilda_hot_reload&) = delete;
+            ilda_hot_reload& operator=(const ilda_hot_reload&) = delete;
+            ~ilda_hot_reload(){
+                stop();
+                delete current.load();
+                for(auto e : retired) delete e;
             }
-            void load_thread_end(){
-                load_mutex.lock();
-                load_mutex.unlock();
+            
+            //loads the file once, then polls its size and mtime every poll_millis. false when the first load fails.
+            const bool start(std::string file_path, std::size_t poll_millis = 250, std::size_t threads = 1){
+                stop();
+                path = file_path;
+                num_threads = threads;
+                if(!reload()) return false;
+                {
+                    std::lock_guard<std::mutex> lock(watch_mutex);
+                    running = true;
+                }
+                watcher = std::thread([this, poll_millis](){ watch(poll_millis); });
+                return true;
             }
             
-            void write(std::string path){
-                std::ofstream ofs(path, std::ios::binary);
-                if(ofs){
-                    ofLogNotice("ofxIldaFile") << "succes open file";
-                    ofLogNotice("ofxIldaFile") << "num sections " << ilda_sections.size();
-                    for(auto& e : ilda_sections){
-                        write_functions::write_sections(e, ofs);
-                    }
-                    ofs.close();
-                    ofLogNotice("ofxIldaFile") << "finish save";
-                }else{
-                    ofLogError("ofxIldaFile", "filed open file");
+            void stop(){
+                {
+                    std::lock_guard<std::mutex> lock(watch_mutex);
+                    running = false;
                 }
+                wake.notify_all();
+                if(watcher.joinable()) watcher.join();
             }
             
+            const bool is_running() const{ return running; }
             
+            //current snapshot, null before the first successful load. lock free : two counter updates,
+            //one pointer load and one reference count increment.
+            std::shared_ptr<const ilda_snapshot> get() const{
+                ++readers;
+                const published* p = current.load();
+                std::shared_ptr<const ilda_snapshot> snapshot = p ? p -> snapshot : std::shared_ptr<const ilda_snapshot>();
+                --readers;
+                return snapshot;
+            }
             
-            const std::string test_dev_draw(std::size_t index, float scale = ofGetHeight() / 2.0){
-                ofPushStyle();
-                scale /= 32767.0;
-                index = index % ilda_sections.size();
-                auto& section = ilda_sections[index];
-                if(section -> format == FORMAT::Coordinates3DwTrueColor){
-                    const auto& frame = *(ilda_section<FORMAT::Coordinates3DwTrueColor>*)section.get();
-                    for(std::size_t i = 1; i < frame.data.size() ; ++i){
-                        const auto& b = frame.data[i - 1];
-                        const auto& e = frame.data[i];
-                        if(!(std::get<1>(b) & (1 << 6))){
-                            const auto& b_col = std::get<2>(b);
-                            ofSetColor(b_col);
-                            ofDrawCircle(std::get<0>(b) * scale, 1.5);
-                            if(!(std::get<1>(e) & (1 << 6))){
-                                const auto& e_col = std::get<2>(e);
-                                ofSetColor((b_col.r + e_col.r) * 0.5, (b_col.g + e_col.g) * 0.5, (b_col.b + e_col.b) * 0.5);
-                                ofDrawLine(std::get<0>(b) * scale, std::get<0>(e) * scale);
-                            }
-                        }
+            //called on the reloading thread after each publish
+            void set_callback(callback_type fn){
+                std::lock_guard<std::mutex> lock(reload_mutex);
+                callback = fn;
+            }
+            
+            //decodes the file now and publishes it. a file that cannot be opened keeps the current snapshot.
+            const bool reload(){
+                std::lock_guard<std::mutex> lock(reload_mutex);
+                uint64_t size;
+                int64_t mtime;
+                if(!util::file_stamp(path, size, mtime)) return false;
+                util::mapped_file mapped;
+                if(!mapped.open(path)){
+                    ofLogError("ofxIldaFile", "filed open file");
+                    return false;
+                }
+                //a write that lands while decoding changes the stamp again and is picked up by the next poll
+                stamp_size = size;
+                stamp_mtime = mtime;
+                
+                const uint8_t* bytes = mapped.data();
+                const std::size_t length = mapped.size();
+                std::shared_ptr<ilda_snapshot> next(new ilda_snapshot());
+                load_functions::build_index(bytes, length, next -> section_index);
+                const std::size_t count = next -> section_index.size();
+                
+                const std::shared_ptr<const ilda_snapshot> previous = get();
+                std::unordered_multimap<uint64_t, std::size_t> known;
+                if(previous){
+                    for(std::size_t i = 0 ; i < previous -> section_hashes.size() ; ++i) known.emplace(previous -> section_hashes[i], i);
+                }
+                
+                //palettes are resolved in file order here, changed palette sections are decoded right away
+                std::vector<std::shared_ptr<ilda_section_base>> sections(count);
+                std::vector<std::shared_ptr<const ilda_palette>> palettes(count);
+                std::vector<uint64_t> hashes(count);
+                std::vector<std::size_t> changed;
+                std::size_t reused = 0;
+                std::vector<uint8_t> encoded;
+                std::shared_ptr<const ilda_palette> palette = ilda_palette::default_palette();
+                for(std::size_t i = 0 ; i < count ; ++i){
+                    const section_entry& entry = next -> section_index[i];
+                    const std::size_t end = std::min<std::size_t>(length, entry.offset + load_functions::commons::header_size + entry.number_of_records * load_functions::commons::record_size((FORMAT)entry.format));
+                    const uint8_t* src = bytes + entry.offset;
+                    hashes[i] = util::hash_bytes(src, end - entry.offset);
+                    const bool indexed = entry.format == FORMAT::Coordinates3D || entry.format == FORMAT::Coordinates2D;
+                    auto range = known.equal_range(hashes[i]);
+                    for(auto it = range.first ; it != range.second ; ++it){
+                        const std::shared_ptr<ilda_section_base>& old = previous -> ilda_sections[it -> second];
+                        if(old -> format != entry.format || write_functions::section_size(*old) != end - entry.offset) continue;
+                        //the hash only finds candidates, the old section encodes back to exactly these bytes or is not reused
+                        encoded.resize(end - entry.offset);
+                        write_functions::encode_section(*old, encoded.data());
+                        if(std::memcmp(encoded.data(), src, encoded.size()) != 0) continue;
+                        if(indexed && load_functions::get_palette(*old) -> lut != palette -> lut) continue;
+                        sections[i] = old;
+                        break;
                     }
-                    
-                    if(frame.data.size()){
-                        auto& rast = frame.data.back();
-                        if(!(std::get<1>(rast) & (1 << 6))){
-                            ofSetColor(std::get<2>(rast));
-                            ofDrawCircle(std::get<0>(rast) * scale, 1.5);
+                    if(sections[i]){
+                        ++reused;
+                    }else{
+                        if(entry.format == FORMAT::ColorPalette){
+                            load_functions::load_section(sections[i], src, length - entry.offset);
+                        }else{
+                            changed.push_back(i);
+                            palettes[i] = palette;
                         }
                     }
+                    if(sections[i] && sections[i] -> format == FORMAT::ColorPalette){
+                        palette = static_cast<const ilda_section<FORMAT::ColorPalette>&>(*sections[i]).to_palette();
+                    }
                 }
-                ofPopStyle();
-                std::stringstream ss("");
-                ss
-                << "index              : " << index << "\n"
-                << "frame name         : " << section -> name << "\n"
-                << "company name       : " << section -> company_name << "\n"
-                << "number_of_records  : " << section -> number_of_records << "\n"
-                << "frame number       : " << section -> frame_number << "\n"
-                << "total frames       : " << section -> total_frames << std::endl;
-                return ss.str();
+                
+                util::worker_pool pool(std::min(num_threads, changed.size()));
+                pool.parallel_for(changed.size(), [&](std::size_t n, std::size_t worker){
+                    const std::size_t i = changed[n];
+                    const section_entry& entry = next -> section_index[i];
+                    std::shared_ptr<ilda_section_base> section;
+                    if(load_functions::load_section(section, bytes + entry.offset, length - entry.offset)){
+                        //reused sections are never touched, only the new ones get their palette
+                        load_functions::set_palette(*section, palettes[i]);
+                        sections[i] = section;
+                    }
+                });
+                
+                //malformed sections are dropped, as load does
+                std::vector<section_entry> index;
+                for(std::size_t i = 0 ; i < count ; ++i){
+                    if(!sections[i]) continue;
+                    next -> ilda_sections.push_back(sections[i]);
+                    next -> section_hashes.push_back(hashes[i]);
+                    index.push_back(next -> section_index[i]);
+                }
+                next -> section_index.swap(index);
+                next -> version = previous ? previous -> version + 1 : 1;
+                
+                num_reused += reused;
+                num_decoded += count - reused;
+                ++num_reloads;
+                const std::shared_ptr<const ilda_snapshot> snapshot(next);
+                publish(snapshot);
+                ofLogNotice("ofxIldaFile") << "reload " << path << " version " << snapshot -> version << ", decoded " << count - reused << " / " << count;
+                if(callback) callback(snapshot);
+                return true;
             }
             
-            std::vector<std::shared_ptr<ilda_section_base>> ilda_sections;
+            uint64_t get_num_reloads() const{ return num_reloads; }
+            //sections taken over from the previous snapshot / decoded, summed over all reloads
+            uint64_t get_num_reused() const{ return num_reused; }
+            uint64_t get_num_decoded() const{ return num_decoded; }
+            
         private:
-            std::string path_buf;
-            std::mutex load_mutex;
+            //holder of one published snapshot. get() copies the shared_ptr out of it, so a replaced holder is retired
+            //and deleted only after a grace period, once no get() is in flight.
+            struct published{
+                std::shared_ptr<const ilda_snapshot> snapshot;
+            };
+            
+            //reload_mutex held. a get() that starts after the exchange sees the new holder, one still in flight
+            //keeps readers above zero, so retired holders are never deleted under it.
+            void publish(const std::shared_ptr<const ilda_snapshot>& snapshot){
+                published* old = current.exchange(new published{snapshot});
+                if(old) retired.push_back(old);
+                reclaim();
+            }
+            
+            //reload_mutex held
+            void reclaim(){
+                if(retired.empty() || readers.load() != 0) return;
+                for(auto e : retired) delete e;
+                retired.clear();
+            }
+            
+            //a changed stamp has to hold for one more poll, so a file that is still being written is not read half way.
+            //holders left over from a reload that overlapped a get() are reclaimed on the following polls.
+            void watch(std::size_t poll_millis){
+                uint64_t pending_size = stamp_size;
+                int64_t pending_mtime = stamp_mtime;
+                std::unique_lock<std::mutex> lock(watch_mutex);
+                while(running){
+                    wake.wait_for(lock, std::chrono::milliseconds(poll_millis), [this](){ return !running; });
+                    if(!running) break;
+                    {
+                        std::lock_guard<std::mutex> reload_lock(reload_mutex);
+                        reclaim();
+                    }
+                    uint64_t size;
+                    int64_t mtime;
+                    if(!util::file_stamp(path, size, mtime)) continue;
+                    if(size == stamp_size && mtime == stamp_mtime) continue;
+                    if(size != pending_size || mtime != pending_mtime){
+                        pending_size = size;
+                        pending_mtime = mtime;
+                        continue;
+                    }
+                    lock.unlock();
+                    reload();
+                    lock.lock();
+                }
+            }
+            
+            std::string path;
+            std::size_t num_threads = 1;
+            std::atomic<published*> current{nullptr};
+            mutable std::atomic<uint32_t> readers{0};
+            std::vector<published*> retired;
+            callback_type callback;
+            std::mutex reload_mutex;
+            std::atomic<uint64_t> stamp_size{0};
+            std::atomic<int64_t> stamp_mtime{0};
+            
+            std::thread watcher;
+            std::mutex watch_mutex;
+            std::condition_variable wake;
+            std::atomic<bool> running{false};
+            
+            std::atomic<uint64_t> num_reloads{0};
+            std::atomic<uint64_t> num_reused{0};
+            std::atomic<uint64_t> num_decoded{0};
         };
         
 #ifdef OFX_ILDA_CONVERT
         struct points_buffer{
+            //frames are kept as immutable buffers, with a frame store identical frames share one
             void set_frame(uint16_t frame_number, const std::vector<ofxIlda::Point>& points){
-                if(frame_buffer.count(frame_number)){
-                    frame_buffer[frame_number].resize(points.size());
-                    std::copy(points.begin(), points.end(), frame_buffer[frame_number].begin());
-                }else{
-                    frame_buffer[frame_number] = points;
+                auto& frame = frame_buffer[frame_number];
+                frame = store ? store -> intern(points) : std::make_shared<const std::vector<ofxIlda::Point>>(points);
+                if(recorder && recorder -> is_open()){
+                    encode_frame(recorder -> get_header(), 0, frame -> size() ? frame.get() : nullptr, record_buffer);
+                    recorder -> append(record_buffer);
                 }
             }
             
+            //while the recorder is open every set_frame is also appended to its file. null stops recording.
+            void set_recorder(const std::shared_ptr<ilda_recorder>& frame_recorder){ recorder = frame_recorder; }
+            const std::shared_ptr<ilda_recorder>& get_recorder() const{ return recorder; }
+            
+            //null by default, set a store to share the buffers of identical frames
+            void set_frame_store(const std::shared_ptr<frame_store>& shared_store){ store = shared_store; }
+            const std::shared_ptr<frame_store>& get_frame_store() const{ return store; }
+            
             void to_file(ilda_file& file, std::string frame_name = "hogehoge", std::string company_name = "ofxIldaF"){
+                file.load_thread_end();
                 auto& sections = file.ilda_sections;
                 uint16_t total_frame = get_max_frame();
                 uint16_t section_total_frame = total_frame + 1;
                 std::shared_ptr<ilda_section_base> pre_frame_ptr(new ilda_section<FORMAT::Coordinates2DwTrueColor>());
                 {
-                    auto& pre_frame = *(ilda_section<FORMAT::Coordinates2DwTrueColor>*)pre_frame_ptr.get();
+                    auto& pre_frame = static_cast<ilda_section<FORMAT::Coordinates2DwTrueColor>&>(*pre_frame_ptr);
                     pre_frame.format = FORMAT::Coordinates2DwTrueColor;
                     pre_frame.name = frame_name;
                     pre_frame.company_name = company_name;
@@ -452,19 +3891,20 @@ namespace ofx{
                     std::get<2>(pre_frame.data[0]).set(0,0,0,255);
                 }
                 for(uint16_t f = 0 ; f < total_frame ; ++f){
-                    std::shared_ptr<ilda_section_base> current_frame_ptr(new ilda_section<FORMAT::Coordinates2DwTrueColor>(*(ilda_section<FORMAT::Coordinates2DwTrueColor>*)pre_frame_ptr.get()));
+                    std::shared_ptr<ilda_section_base> current_frame_ptr(new ilda_section<FORMAT::Coordinates2DwTrueColor>(static_cast<ilda_section<FORMAT::Coordinates2DwTrueColor>&>(*pre_frame_ptr)));
                     if(frame_buffer.count(f)){
-                        const auto& ilda_frame = frame_buffer[f];
-                        auto& current_frame = *(ilda_section<FORMAT::Coordinates2DwTrueColor>*)current_frame_ptr.get();
+                        const auto& ilda_frame = *frame_buffer[f];
+                        auto& current_frame = static_cast<ilda_section<FORMAT::Coordinates2DwTrueColor>&>(*current_frame_ptr);
                         current_frame.frame_number = f;
                         current_frame.projector_number = 0;
                         current_frame.none = 0;
                         if(ilda_frame.size()){
                             current_frame.number_of_records = ilda_frame.size();
-                            current_frame.data.resize(ilda_frame.size());
+                            auto& frame_data = current_frame.data;
+                            frame_data.resize(ilda_frame.size());
                             
                             for(uint16_t i = 0 ; i < current_frame.number_of_records ; ++i){
-                                auto& section_frame_data = current_frame.data[i];
+                                auto& section_frame_data = frame_data[i];
                                 auto& ilda_point = ilda_frame[i];
                                 std::get<0>(section_frame_data).set(ilda_point.x, ilda_point.y);
                                 std::get<1>(section_frame_data) = 0b00000000;
@@ -481,17 +3921,16 @@ namespace ofx{
                             std::get<1>(current_frame.data[0]) = 0b01000000;
                             std::get<2>(current_frame.data[0]).set(0,0,0,255);
                         }
-                        
                     }else{
-                        auto& current_frame = *(ilda_section<FORMAT::Coordinates2DwTrueColor>*)current_frame_ptr.get();
+                        auto& current_frame = static_cast<ilda_section<FORMAT::Coordinates2DwTrueColor>&>(*current_frame_ptr);
                         current_frame.frame_number = f;
                     }
                     pre_frame_ptr = current_frame_ptr;
                     sections.push_back(pre_frame_ptr);
                 }
                 {
-                    std::shared_ptr<ilda_section_base> current_frame_ptr(new ilda_section<FORMAT::Coordinates2DwTrueColor>(*(ilda_section<FORMAT::Coordinates2DwTrueColor>*)pre_frame_ptr.get()));
-                    auto& current_frame = *(ilda_section<FORMAT::Coordinates2DwTrueColor>*)current_frame_ptr.get();
+                    std::shared_ptr<ilda_section_base> current_frame_ptr(new ilda_section<FORMAT::Coordinates2DwTrueColor>(static_cast<ilda_section<FORMAT::Coordinates2DwTrueColor>&>(*pre_frame_ptr)));
+                    auto& current_frame = static_cast<ilda_section<FORMAT::Coordinates2DwTrueColor>&>(*current_frame_ptr);
                     current_frame.number_of_records = 0;
                     current_frame.frame_number = total_frame;
                     current_frame.data.resize(0);
@@ -501,7 +3940,109 @@ namespace ofx{
                 }
             }
             
+            //streams the sections to_file would create straight to path, without building ilda_sections.
+            //frames are converted in batches on the pool and written in order, so memory stays at one batch of encoded frames.
+            const bool write_file(std::string path, std::string frame_name = "hogehoge", std::string company_name = "ofxIldaF", std::size_t num_threads = std::thread::hardware_concurrency()){
+                util::worker_pool pool(num_threads);
+                return write_file(path, pool, frame_name, company_name);
+            }
+            
+            const bool write_file(std::string path, util::worker_pool& pool, std::string frame_name = "hogehoge", std::string company_name = "ofxIldaF"){
+                std::ofstream ofs(path, std::ios::binary);
+                if(!ofs){
+                    ofLogError("ofxIldaFile", "filed open file");
+                    return false;
+                }
+                const uint16_t total_frame = get_max_frame();
+                ilda_section_base header;
+                header.format = FORMAT::Coordinates2DwTrueColor;
+                header.name = frame_name;
+                header.company_name = company_name;
+                header.number_of_records = 0;
+                header.frame_number = 0;
+                header.total_frames = total_frame + 1;
+                header.projector_number = 0;
+                header.none = 0;
+                
+                //a missing frame repeats the last frame before it, nullptr stands for the single blank point
+                const std::size_t batch_size = pool.size() * 16;
+                std::vector<const std::vector<ofxIlda::Point>*> sources(batch_size);
+                std::vector<std::vector<uint8_t>> encoded(batch_size);
+                const std::vector<ofxIlda::Point>* source = nullptr;
+                auto next = frame_buffer.begin();
+                uint64_t bytes_written = 0;
+                for(std::size_t first = 0 ; first < total_frame ; first += batch_size){
+                    const std::size_t count = std::min<std::size_t>(batch_size, total_frame - first);
+                    for(std::size_t i = 0 ; i < count ; ++i){
+                        if(next != frame_buffer.end() && next -> first == first + i){
+                            source = next -> second -> size() ? next -> second.get() : nullptr;
+                            ++next;
+                        }
+                        sources[i] = source;
+                    }
+                    pool.parallel_for(count, [&](std::size_t i, std::size_t worker){
+                        encode_frame(header, first + i, sources[i], encoded[i]);
+                    });
+                    for(std::size_t i = 0 ; i < count ; ++i){
+                        ofs.write((char*)encoded[i].data(), encoded[i].size());
+                        bytes_written += encoded[i].size();
+                    }
+                }
+                header.frame_number = total_frame;
+                uint8_t end_of_file[load_functions::commons::header_size];
+                write_functions::commons::encode_header(header, end_of_file);
+                ofs.write((char*)end_of_file, sizeof(end_of_file));
+                bytes_written += sizeof(end_of_file);
+                ofs.close();
+                ofLogNotice("ofxIldaFile") << "finish save num frames " << total_frame << " bytes " << bytes_written << " workers " << pool.size();
+                return !ofs.fail();
+            }
+            
         private:
+            //ofxIlda intensity 0..65535 -> 0..255, same truncation as to_file
+            static const std::array<uint8_t, 65536>& intensity_table(){
+                static const std::array<uint8_t, 65536> table = [](){
+                    std::array<uint8_t, 65536> t;
+                    for(uint32_t v = 0 ; v < t.size() ; ++v) t[v] = v * 255 / kIldaMaxIntensity;
+                    return t;
+                }();
+                return table;
+            }
+            
+            //one Coordinates2DwTrueColor section, header included
+            static void encode_frame(const ilda_section_base& header, uint16_t frame_number, const std::vector<ofxIlda::Point>* points, std::vector<uint8_t>& out){
+                typedef format_traits<FORMAT::Coordinates2DwTrueColor> traits;
+                const std::size_t num = points ? points -> size() : 1;
+                out.resize(header_layout::size + num * traits::record_size);
+                write_functions::commons::encode_header(header, out.data());
+                util::write_16b(out.data() + header_layout::number_of_records, uint16_t(num));
+                util::write_16b(out.data() + header_layout::frame_number, frame_number);
+                uint8_t* dst = out.data() + header_layout::size;
+                if(!points){
+                    const int16_t zero = 0;
+                    const uint8_t blank = 1 << 6;
+                    const uint32_t black = 0;
+                    kernels::encode<FORMAT::Coordinates2DwTrueColor>(&zero, &zero, nullptr, &blank, &black, 1, dst);
+                    return;
+                }
+                const std::array<uint8_t, 65536>& table = intensity_table();
+                const std::size_t block = 256;
+                int16_t x[block], y[block];
+                uint8_t status[block];
+                uint32_t color[block];
+                std::fill(status, status + block, 0);
+                for(std::size_t first = 0 ; first < num ; first += block, dst += block * traits::record_size){
+                    const std::size_t n = std::min(block, num - first);
+                    for(std::size_t i = 0 ; i < n ; ++i){
+                        const ofxIlda::Point& p = (*points)[first + i];
+                        x[i] = p.x;
+                        y[i] = p.y;
+                        color[i] = uint32_t(table[p.r]) << 16 | uint32_t(table[p.g]) << 8 | uint32_t(table[p.b]);
+                    }
+                    kernels::encode<FORMAT::Coordinates2DwTrueColor>(x, y, nullptr, status, color, n, dst);
+                }
+            }
+            
             uint16_t get_max_frame() const{
                 uint16_t _m = 0;
                 for(auto& e : frame_buffer){
@@ -510,7 +4051,10 @@ namespace ofx{
                 return _m;
             }
             
-            std::map<uint16_t ,std::vector<ofxIlda::Point>> frame_buffer;
+            std::map<uint16_t ,std::shared_ptr<const std::vector<ofxIlda::Point>>> frame_buffer;
+            std::shared_ptr<frame_store> store;
+            std::shared_ptr<ilda_recorder> recorder;
+            std::vector<uint8_t> record_buffer;
         };
         
 #endif